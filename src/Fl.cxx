@@ -29,6 +29,7 @@
 
 #include <ctype.h>
 #include <stdlib.h>
+#include <math.h>
 #include "flstring.h"
 
 #if defined(DEBUG) || defined(DEBUG_WATCH)
@@ -69,6 +70,8 @@ void            *Fl::e_clipboard_data = NULL;
 
 Fl_Event_Dispatch Fl::e_dispatch = 0;
 
+double          Fl::max_fps_ = 0.0;
+
 unsigned char   Fl::options_[] = { 0, 0 };
 unsigned char   Fl::options_read_ = 0;
 
@@ -607,26 +610,73 @@ void Fl::redraw() {
   for (Fl_X* i = Fl_X::first; i; i = i->next) i->w->redraw();
 }
 
+// Frame rate governor, see Fl::max_fps() and Fl_Window::present_interval()
+static double next_frame;       // monotonic time of the next frame
+static char flush_deferred;     // damage was held back until a later frame
+static double flush_timer_at;   // when the pending wake_for_flush() timeout expires, or 0
+
+static void flush_timeout_cb(void *) {
+  // nothing to do: the event loop calls Fl::flush() after the timeouts
+  flush_timer_at = 0;
+}
+
+// makes sure that the event loop wakes up at monotonic time t
+static void wake_for_flush(double t, double now) {
+  if (flush_timer_at && flush_timer_at <= t) return;
+  if (flush_timer_at) Fl::remove_timeout(flush_timeout_cb);
+  flush_timer_at = t;
+  Fl::add_timeout(t - now, flush_timeout_cb);
+}
+
 /**
   Causes all the windows that need it to be redrawn and graphics forced
   out through the pipes.
 
   This is what wait() does before looking for events.
 
+  When a frame rate is set with Fl::max_fps(double), or a window has a
+  Fl_Window::present_interval(double), windows damaged before their next
+  frame are not redrawn but keep their damage until then.
+
   Note: in multi-threaded applications you should only call Fl::flush()
   from the main thread. If a child thread needs to trigger a redraw event,
   it should instead call Fl::awake() to get the main thread to process the
   event queue.
 */
 void Fl::flush() {
-  if (damage()) {
+  if (damage() || flush_deferred) {
+    double now = -1;
+    if (max_fps_ > 0) {
+      now = system_driver()->monotonic_time();
+      if (now < next_frame) {
+        // too early: keep the damage for the next frame
+        damage_ = 0;
+        flush_deferred = 1;
+        wake_for_flush(next_frame, now);
+        screen_driver()->flush();
+        return;
+      }
+      next_frame = (floor(now * max_fps_) + 1) / max_fps_;
+    }
     damage_ = 0;
+    flush_deferred = 0;
     for (Fl_X* i = Fl_X::first; i; i = i->next) {
       Fl_Window* wi = i->w;
-      if (Fl_Window_Driver::driver(wi)->wait_for_expose_value) {damage_ = 1; continue;}
+      Fl_Window_Driver *d = Fl_Window_Driver::driver(wi);
+      if (d->wait_for_expose_value) {damage_ = 1; continue;}
       if (!wi->visible_r()) continue;
       if (wi->damage()) {
-        Fl_Window_Driver::driver(wi)->flush();
+        if (d->present_interval > 0) {
+          if (now < 0) now = system_driver()->monotonic_time();
+          if (now < d->next_present) {
+            // keep the damage region, later damage is merged into it
+            flush_deferred = 1;
+            wake_for_flush(d->next_present, now);
+            continue;
+          }
+          d->next_present = (floor(now / d->present_interval) + 1) * d->present_interval;
+        }
+        d->flush();
         wi->clear_damage();
       }
       // destroy damage regions for windows that don't use them:
@@ -634,11 +684,40 @@ void Fl::flush() {
         fl_graphics_driver->XDestroyRegion(i->region);
         i->region = 0;
       }
+      d->damage_rects_count = 0;
     }
   }
   screen_driver()->flush();
 }
 
+/**
+  Limits how often Fl::flush() redraws windows.
+
+  With a positive \p fps, windows are redrawn at most \p fps times per
+  second, at multiples of 1/\p fps seconds on a monotonic clock. All damage
+  between two frames is merged and drawn once, which saves a lot of CPU
+  time in programs that change widgets from high-rate callbacks, for
+  instance an Fl_Progress updated for every block read.
+
+  Note that this also applies to explicit calls of Fl::flush(): the event
+  loop draws the remaining damage when the next frame is due.
+  The default, 0, redraws windows whenever Fl::flush() is called.
+
+  \see Fl_Window::present_interval(double)
+*/
+void Fl::max_fps(double fps) {
+  max_fps_ = fps > 0 ? fps : 0;
+  next_frame = 0;
+}
+
+/**
+  Returns the maximum number of redraws per second, or 0 for no limit.
+  \see Fl::max_fps(double)
+*/
+double Fl::max_fps() {
+  return max_fps_;
+}
+
 
 ////////////////////////////////////////////////////////////////
 // Event handlers:
@@ -1471,6 +1550,7 @@ void Fl_Widget::damage(uchar fl) {
       fl_graphics_driver->XDestroyRegion(i->region);
       i->region = 0;
     }
+    Fl_Window_Driver::driver((Fl_Window*)this)->damage_rects_count = 0;
     damage_ |= fl;
     Fl::damage(FL_DAMAGE_CHILD);
   }
@@ -1505,12 +1585,16 @@ void Fl_Widget::damage(uchar fl, int X, int Y, int W, int H) {
     // if we already have damage we must merge with existing region:
     if (i->region) {
       fl_graphics_driver->add_rectangle_to_region(i->region, X, Y, W, H);
+      Fl_Window_Driver::driver((Fl_Window*)wi)->add_damage_rect(X, Y, W, H);
     }
     wi->damage_ |= fl;
   } else {
     // create a new region:
     if (i->region) fl_graphics_driver->XDestroyRegion(i->region);
     i->region = fl_graphics_driver->XRectangleRegion(X,Y,W,H);
+    Fl_Window_Driver *d = Fl_Window_Driver::driver((Fl_Window*)wi);
+    d->damage_rects_count = 0;
+    d->add_damage_rect(X, Y, W, H);
     wi->damage_ = fl;
   }
   Fl::damage(FL_DAMAGE_CHILD);
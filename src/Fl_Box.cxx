@@ -16,20 +16,61 @@
 
 #include <FL/Fl_Widget.H>
 #include <FL/Fl_Box.H>
+#include "Fl_Display_List.H"
 
 
 Fl_Box::Fl_Box(int X, int Y, int W, int H, const char *l)
 : Fl_Widget(X,Y,W,H,l)
 {
+  dlist_ = 0;
 }
 
 Fl_Box::Fl_Box(Fl_Boxtype b, int X, int Y, int W, int H, const char *l)
 : Fl_Widget(X,Y,W,H,l)
 {
+  dlist_ = 0;
   box(b);
 }
 
+Fl_Box::~Fl_Box() {
+  delete dlist_;
+}
+
+/**
+  Makes the box record its drawing and replay the recording later.
+
+  Boxes drawn with the plastic or gleam schemes and boxes with long,
+  multi-line labels spend most of their drawing time computing gradients
+  and laying out text. With \p on set, the box records the colors, lines,
+  rectangles and text it draws the first time, and later draws replay that
+  recording. Any change of the size, box type, colors, label, label
+  attributes, active state, scheme or scale makes the box record again;
+  moving the box does not.
+
+  Boxes whose drawing uses images, symbols or other operations that cannot
+  be recorded are drawn as usual. Setting \p on again discards the
+  recording, for instance after the color map was changed with
+  Fl::set_color().
+
+  \note Derived classes that override draw() do not use the recording.
+*/
+void Fl_Box::retained(int on) {
+  delete dlist_;
+  dlist_ = on ? new Fl_Display_List : 0;
+}
+
 void Fl_Box::draw() {
+  if (dlist_) {
+    int state = flags() & SHORTCUT_LABEL;
+    int valid = dlist_->valid(this, state);
+    if (!valid && dlist_->begin(this, state)) {
+      draw_box();
+      draw_label();
+      dlist_->end();
+      valid = 1;
+    }
+    if (valid && dlist_->replay(x(), y())) return;
+  }
   draw_box();
   draw_label();
 }
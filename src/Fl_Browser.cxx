@@ -28,9 +28,13 @@
 
 // I modified this from the original Forms data to use a linked list
 // so that the number of items in the browser and size of those items
-// is unlimited. The only problem is that the old browser used an
-// index number to identify a line, and it is slow to convert from/to
-// a pointer. I use a cache of the last match to try to speed this up.
+// is unlimited. The old browser used an index number to identify a
+// line, so an array of pointers to all lines is kept as well. Each line
+// remembers its index in that array, these numbers are updated lazily
+// after lines are inserted or removed. The line heights are kept in a
+// Fenwick tree (binary indexed tree) indexed by line number, so that
+// the scroll position of a line and the line at a scroll position can
+// be found in O(log n) time.
 
 // Also added the ability to "hide" a line. This sets its height to
 // zero, so the Fl_Browser_ cannot pick it.
@@ -48,11 +52,86 @@ struct FL_BLINE {       // data is in a linked list of these
   FL_BLINE* next;
   void* data;
   Fl_Image* icon;
+  int line;             // line number, valid if items_[line-1] == this
+  int height;           // item_height() as stored in the height index
   short length;         // sizeof(txt)-1, may be longer than string
   char flags;           // selected, displayed
   char txt[1];          // start of allocated array
 };
 
+// In virtual mode no lines are stored. The items passed to Fl_Browser_
+// are the line numbers, and the text of the lines is fetched with the
+// lines callback into a small cache, where line n is kept in slot
+// n % VIRTUAL_CACHE. This keeps all visible lines while scrolling.
+
+#define VIRTUAL_CACHE 256
+
+struct Fl_Browser_Virtual {
+  Fl_Browser_Line_Cb *cb;       // returns the text of a line
+  void *data;                   // user data for cb
+  int height;                   // height of all lines, or -1 if not measured
+  int *selected;                // sorted array of the selected lines
+  int nselected;                // number of selected lines
+  int alloc;                    // allocated size of selected
+  FL_BLINE *cache[VIRTUAL_CACHE]; // recently used lines, or NULL
+};
+
+static inline void *virtual_item(int line) { return (void*)(fl_intptr_t)line; }
+static inline int virtual_lineno(void *item) { return (int)(fl_intptr_t)item; }
+
+// Returns the index of line in the selected lines, or where to insert it.
+static int virtual_find(const Fl_Browser_Virtual *v, int line) {
+  int a = 0, b = v->nselected;
+  while (a < b) {
+    int m = (a+b)/2;
+    if (v->selected[m] < line) a = m+1; else b = m;
+  }
+  return a;
+}
+
+static int virtual_selected(const Fl_Browser_Virtual *v, int line) {
+  int i = virtual_find(v, line);
+  return i < v->nselected && v->selected[i] == line;
+}
+
+/** \internal
+  Returns the cached line \p line in virtual mode, calls the lines callback
+  if the line is not in the cache.
+*/
+FL_BLINE *Fl_Browser::virtual_line(int line) const {
+  Fl_Browser_Virtual *v = virtual_;
+  FL_BLINE *l = v->cache[line % VIRTUAL_CACHE];
+  if (!l || l->line != line) {
+    Fl_Image *icon = 0;
+    const char *newtext = v->cb((Fl_Browser*)this, line, &icon, v->data);
+    if (!newtext) newtext = "";
+    int len = (int) strlen(newtext);
+    if (!l || len > l->length) {
+      l = (FL_BLINE*)realloc(l, sizeof(FL_BLINE)+len);
+      l->length = (short)len;
+      v->cache[line % VIRTUAL_CACHE] = l;
+    }
+    strcpy(l->txt, newtext);
+    l->prev = l->next = 0;
+    l->data = 0;
+    l->icon = icon;
+    l->line = line;
+    l->height = -1;
+  }
+  l->flags = virtual_selected(v, line) ? SELECTED : 0;
+  return l;
+}
+
+/** \internal
+  Returns the height of all lines in virtual mode, which is the height of
+  the first line.
+*/
+int Fl_Browser::virtual_height() const {
+  if (virtual_->height < 0 && lines)
+    virtual_->height = line_height(virtual_line(1));
+  return virtual_->height < 0 ? 0 : virtual_->height;
+}
+
 /**
   Returns the very first item in the list.
   Example of use:
@@ -65,7 +144,10 @@ struct FL_BLINE {       // data is in a linked list of these
   \returns The first item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_first() const {return first;}
+void* Fl_Browser::item_first() const {
+  if (virtual_) return lines ? virtual_item(1) : 0;
+  return first;
+}
 
 /**
   Returns the next item after \p item.
@@ -73,7 +155,10 @@ void* Fl_Browser::item_first() const {return first;}
   \returns The next item after \p item, or NULL if there are none after this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
+void* Fl_Browser::item_next(void* item) const {
+  if (virtual_) return virtual_lineno(item) < lines ? virtual_item(virtual_lineno(item)+1) : 0;
+  return ((FL_BLINE*)item)->next;
+}
 
 /**
   Returns the previous item before \p item.
@@ -81,7 +166,10 @@ void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
   \returns The previous item before \p item, or NULL if there are none before this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
+void* Fl_Browser::item_prev(void* item) const {
+  if (virtual_) return virtual_lineno(item) > 1 ? virtual_item(virtual_lineno(item)-1) : 0;
+  return ((FL_BLINE*)item)->prev;
+}
 
 /**
   Returns the very last item in the list.
@@ -95,7 +183,10 @@ void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
   \returns The last item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_last() const {return last;}
+void* Fl_Browser::item_last() const {
+  if (virtual_) return lines ? virtual_item(lines) : 0;
+  return last;
+}
 
 /**
   See if \p item is selected.
@@ -104,6 +195,7 @@ void* Fl_Browser::item_last() const {return last;}
   \see select(), selected(), value(), item_select(), item_selected()
 */
 int Fl_Browser::item_selected(void* item) const {
+  if (virtual_) return virtual_selected(virtual_, virtual_lineno(item));
   return ((FL_BLINE*)item)->flags&SELECTED;
 }
 /**
@@ -113,6 +205,25 @@ int Fl_Browser::item_selected(void* item) const {
   \see select(), selected(), value(), item_select(), item_selected()
 */
 void Fl_Browser::item_select(void *item, int val) {
+  if (virtual_) {
+    Fl_Browser_Virtual *v = virtual_;
+    int line = virtual_lineno(item);
+    int i = virtual_find(v, line);
+    int sel = i < v->nselected && v->selected[i] == line;
+    if (val && !sel) {
+      if (v->nselected >= v->alloc) {
+        v->alloc = v->alloc ? 2*v->alloc : 16;
+        v->selected = (int*)realloc(v->selected, v->alloc*sizeof(int));
+      }
+      memmove(v->selected+i+1, v->selected+i, (v->nselected-i)*sizeof(int));
+      v->selected[i] = line;
+      v->nselected++;
+    } else if (!val && sel) {
+      v->nselected--;
+      memmove(v->selected+i, v->selected+i+1, (v->nselected-i)*sizeof(int));
+    }
+    return;
+  }
   if (val) ((FL_BLINE*)item)->flags |= SELECTED;
   else     ((FL_BLINE*)item)->flags &= ~SELECTED;
 }
@@ -123,19 +234,14 @@ void Fl_Browser::item_select(void *item, int val) {
   \returns The item's text string. (Can be NULL)
 */
 const char *Fl_Browser::item_text(void *item) const {
+  if (virtual_) return virtual_line(virtual_lineno(item))->txt;
   return ((FL_BLINE*)item)->txt;
 }
 
 /**
   Returns the item for specified \p line.
 
-  Note: This call is slow. It's fine for e.g. responding to user
-  clicks, but slow if called often, such as in a tight sorting loop.
-  Finding an item 'by line' involves a linear lookup on the internal
-  linked list. The performance hit can be significant if the browser's
-  contents is large, and the method is called often (e.g. during a sort).
-  If you're writing a subclass, use the protected methods item_first(),
-  item_next(), etc. to access the internal linked list more efficiently.
+  This is a constant time lookup in the array of all items.
 
   \param[in] line The line number of the item to return. (1 based)
   \retval item that was found.
@@ -143,54 +249,142 @@ const char *Fl_Browser::item_text(void *item) const {
   \see item_at(), find_line(), lineno()
 */
 FL_BLINE* Fl_Browser::find_line(int line) const {
-  int n; FL_BLINE* l;
-  if (line == cacheline) return cache;
-  if (cacheline && line > (cacheline/2) && line < ((cacheline+lines)/2)) {
-    n = cacheline; l = cache;
-  } else if (line <= (lines/2)) {
-    n = 1; l = first;
-  } else {
-    n = lines; l = last;
-  }
-  for (; n < line && l; n++) l = l->next;
-  for (; n > line && l; n--) l = l->prev;
-  ((Fl_Browser*)this)->cacheline = line;
-  ((Fl_Browser*)this)->cache = l;
-  return l;
+  if (line < 1 || line > lines) return 0;
+  if (virtual_) return virtual_line(line);
+  return items_[line-1];
+}
+
+/**
+  Return the item at specified \p line.
+  In virtual mode the item is not an FL_BLINE, see virtual_lines().
+  \param[in] line The line of the item to return. (1 based)
+  \returns The item, or NULL if line out of range.
+  \see item_at(), find_line(), lineno()
+*/
+void *Fl_Browser::item_at(int line) const {
+  if (virtual_) return (line < 1 || line > lines) ? 0 : virtual_item(line);
+  return (void*)find_line(line);
 }
 
 /**
   Returns line number corresponding to \p item, or zero if not found.
-  Caveat: See efficiency note in find_line().
+
+  Every item remembers its line number. After lines have been inserted
+  or removed the line numbers of all following items are updated the
+  next time one of them is requested, so that this is usually a constant
+  time operation.
+
   \param[in] item The item to be found
   \returns The line number of the item, or 0 if not found.
   \see item_at(), find_line(), lineno()
 */
 int Fl_Browser::lineno(void *item) const {
+  if (virtual_) {
+    int n = virtual_lineno(item);
+    return (n >= 1 && n <= lines) ? n : 0;
+  }
   FL_BLINE* l = (FL_BLINE*)item;
   if (!l) return 0;
-  if (l == cache) return cacheline;
-  if (l == first) return 1;
-  if (l == last) return lines;
-  if (!cache) {
-    ((Fl_Browser*)this)->cache = first;
-    ((Fl_Browser*)this)->cacheline = 1;
+  int n = l->line;
+  if (n >= 1 && n <= lines && items_[n-1] == l) return n;
+  // renumber the lines after the first change:
+  for (; numbered_ < lines; numbered_++) items_[numbered_]->line = numbered_+1;
+  n = l->line;
+  if (n >= 1 && n <= lines && items_[n-1] == l) return n;
+  return 0;
+}
+
+/** \internal
+  Adds the lines after \p heights_valid_ to the height index.
+
+  Node \p k of the Fenwick tree holds the sum of the heights of the lines
+  k-(k&-k)+1 to k, so the nodes of the first lines stay valid when lines
+  are inserted or removed further down, and new nodes can be appended.
+*/
+void Fl_Browser::index_heights() const {
+  for (int k = heights_valid_+1; k <= lines; k++) {
+    FL_BLINE* l = items_[k-1];
+    int h = l->height;
+    for (int j = k-1; j > k-(k&-k); j -= (j&-j)) h += heights_[j];
+    heights_[k] = h;
   }
-  // assume it is near cache, search both directions:
-  FL_BLINE* b = cache->prev;
-  int bnum = cacheline-1;
-  FL_BLINE* f = cache->next;
-  int fnum = cacheline+1;
-  int n = 0;
-  for (;;) {
-    if (b == l) {n = bnum; break;}
-    if (f == l) {n = fnum; break;}
-    if (b) {b = b->prev; bnum--;}
-    if (f) {f = f->next; fnum++;}
+  heights_valid_ = lines;
+}
+
+/** \internal
+  Measures \p line again and updates the height index.
+*/
+void Fl_Browser::height_changed(int line) {
+  FL_BLINE* l = items_[line-1];
+  int h = item_height(l);
+  int dh = h - l->height;
+  l->height = h;
+  for (int k = line; k <= heights_valid_; k += (k&-k)) heights_[k] += dh;
+}
+
+/**
+  Recalculates the heights of all lines.
+
+  Fl_Browser remembers the item_height() of every line. A subclass that
+  changes the height of its items without changing their text must call
+  this to update full_height() and the scroll positions of the lines.
+*/
+void Fl_Browser::recalc_heights() {
+  if (virtual_) virtual_->height = -1;
+  for (FL_BLINE* l = first; l; l = l->next) l->height = item_height(l);
+  heights_valid_ = 0;
+}
+
+/**
+  Returns the vertical position of \p item in pixels.
+  The position is the sum of the heights of all lines above \p item.
+  \param[in] item The item whose position is returned.
+  \returns The position of the item, or -1 if the item is not found.
+  \see item_at_position(), lineposition()
+*/
+int Fl_Browser::item_position(void *item) const {
+  int line = lineno(item);
+  if (!line) return -1;
+  if (virtual_) return (line-1) * virtual_height();
+  index_heights();
+  int pos = 0;
+  for (int k = line-1; k > 0; k -= (k&-k)) pos += heights_[k];
+  return pos;
+}
+
+/**
+  Returns the item at the vertical position \p pos in pixels.
+  \param[in] pos The vertical position in pixels.
+  \param[out] item_pos The position of the returned item.
+  \returns The item covering \p pos, or the last item if \p pos is
+    after the end of the list, or NULL if the browser is empty.
+  \see item_position()
+*/
+void *Fl_Browser::item_at_position(int pos, int &item_pos) const {
+  if (!lines) return 0;
+  if (virtual_) {
+    int h = virtual_height();
+    int line = (h > 0 && pos >= 0) ? pos/h + 1 : 1;
+    if (line > lines) line = lines;
+    item_pos = (line-1) * h;
+    return virtual_item(line);
   }
-  ((Fl_Browser*)this)->cache = l;
-  ((Fl_Browser*)this)->cacheline = n;
-  return n;
+  index_heights();
+  // find the number of lines ending at or above pos:
+  int n = 0, y = 0, bit = 1;
+  while (2*bit <= lines) bit *= 2;
+  for (; bit; bit /= 2) {
+    if (n+bit <= lines && y+heights_[n+bit] <= pos) {
+      n += bit;
+      y += heights_[n];
+    }
+  }
+  if (n >= lines) {
+    n = lines-1;
+    y -= items_[n]->height;
+  }
+  item_pos = y;
+  return items_[n];
 }
 
 /**
@@ -205,10 +399,10 @@ FL_BLINE* Fl_Browser::_remove(int line) {
   FL_BLINE* ttt = find_line(line);
   deleting(ttt);
 
-  cacheline = line-1;
-  cache = ttt->prev;
   lines--;
-  full_height_ -= item_height(ttt);
+  memmove(items_+line-1, items_+line, (lines-line+1)*sizeof(FL_BLINE*));
+  if (numbered_ > line-1) numbered_ = line-1;
+  if (heights_valid_ > line-1) heights_valid_ = line-1;
   if (ttt->prev) ttt->prev->next = ttt->next;
   else first = ttt->next;
   if (ttt->next) ttt->next->prev = ttt->prev;
@@ -225,7 +419,7 @@ FL_BLINE* Fl_Browser::_remove(int line) {
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::remove(int line) {
-  if (line < 1 || line > lines) return;
+  if (line < 1 || line > lines || virtual_) return;
   free(_remove(line));
 }
 
@@ -239,6 +433,13 @@ void Fl_Browser::remove(int line) {
   \param[in] item  The item to be added.
 */
 void Fl_Browser::insert(int line, FL_BLINE* item) {
+  if (line < 1) line = 1;
+  if (line > lines) line = lines+1;
+  if (lines >= items_alloc_) {
+    items_alloc_ = items_alloc_ ? 2*items_alloc_ : 64;
+    items_ = (FL_BLINE**)realloc(items_, items_alloc_*sizeof(FL_BLINE*));
+    heights_ = (int*)realloc(heights_, (items_alloc_+1)*sizeof(int));
+  }
   if (!first) {
     item->prev = item->next = 0;
     first = last = item;
@@ -261,10 +462,13 @@ void Fl_Browser::insert(int line, FL_BLINE* item) {
     item->prev->next = item;
     n->prev = item;
   }
-  cacheline = line;
-  cache = item;
+  memmove(items_+line, items_+line-1, (lines-line+1)*sizeof(FL_BLINE*));
+  items_[line-1] = item;
+  item->line = line;
+  if (numbered_ > line-1) numbered_ = line-1;
+  if (heights_valid_ > line-1) heights_valid_ = line-1;
   lines++;
-  full_height_ += item_height(item);
+  item->height = item_height(item);
   redraw_line(item);
 }
 
@@ -282,6 +486,7 @@ void Fl_Browser::insert(int line, FL_BLINE* item) {
   \param[in] d Optional pointer to user data to be associated with the new line.
 */
 void Fl_Browser::insert(int line, const char* newtext, void* d) {
+  if (virtual_) return;
   if (!newtext) newtext = "";           // STR #3269
   int l = (int) strlen(newtext);
   FL_BLINE* t = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
@@ -300,7 +505,7 @@ void Fl_Browser::insert(int line, const char* newtext, void* d) {
   \param[in] from Line number of item to be moved
 */
 void Fl_Browser::move(int to, int from) {
-  if (from < 1 || from > lines) return;
+  if (from < 1 || from > lines || virtual_) return;
   insert(to, _remove(from));
 }
 
@@ -316,14 +521,16 @@ void Fl_Browser::move(int to, int from) {
   \param[in] newtext The new string to be assigned to the item.
 */
 void Fl_Browser::text(int line, const char* newtext) {
-  if (line < 1 || line > lines) return;
+  if (line < 1 || line > lines || virtual_) return;
   FL_BLINE* t = find_line(line);
   if (!newtext) newtext = "";           // STR #3269
   int l = (int) strlen(newtext);
   if (l > t->length) {
     FL_BLINE* n = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
     replacing(t, n);
-    cache = n;
+    items_[line-1] = n;
+    n->line = line;
+    n->height = t->height;
     n->data = t->data;
     n->icon = t->icon;
     n->length = (short)l;
@@ -336,7 +543,10 @@ void Fl_Browser::text(int line, const char* newtext) {
     t = n;
   }
   strcpy(t->txt, newtext);
-  redraw_line(t);
+  int h = t->height;
+  height_changed(line);
+  replacing(t, t);                      // measure its width again
+  if (t->height != h) redraw();
 }
 
 /**
@@ -346,7 +556,7 @@ void Fl_Browser::text(int line, const char* newtext) {
   \param[in] d The new data to be assigned to the item. (can be NULL)
 */
 void Fl_Browser::data(int line, void* d) {
-  if (line < 1 || line > lines) return;
+  if (line < 1 || line > lines || virtual_) return;
   find_line(line)->data = d;
 }
 
@@ -359,7 +569,14 @@ void Fl_Browser::data(int line, void* d) {
        incr_height(), full_height()
 */
 int Fl_Browser::item_height(void *item) const {
-  FL_BLINE* l = (FL_BLINE*)item;
+  if (virtual_) return virtual_height();
+  return line_height((FL_BLINE*)item);
+}
+
+/** \internal
+  Measures the height of line \p l, see item_height().
+*/
+int Fl_Browser::line_height(FL_BLINE *l) const {
   if (l->flags & NOTDISPLAYED) return 0;
 
   int hmax = 2; // use 2 to insure we don't return a zero!
@@ -419,7 +636,7 @@ int Fl_Browser::item_height(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::item_width(void *item) const {
-  FL_BLINE* l=(FL_BLINE*)item;
+  FL_BLINE* l = virtual_ ? virtual_line(virtual_lineno(item)) : (FL_BLINE*)item;
   char* str = l->txt;
   const int* i = column_widths();
   int ww = 0;
@@ -478,7 +695,12 @@ int Fl_Browser::item_width(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::full_height() const {
-  return full_height_;
+  if (!lines) return 0;
+  if (virtual_) return lines * virtual_height();
+  index_heights();
+  int h = 0;
+  for (int k = lines; k > 0; k -= (k&-k)) h += heights_[k];
+  return h;
 }
 
 /**
@@ -500,7 +722,7 @@ int Fl_Browser::incr_height() const {
   \param[in] X,Y,W,H position and size.
 */
 void Fl_Browser::item_draw(void* item, int X, int Y, int W, int H) const {
-  FL_BLINE* l = (FL_BLINE*)item;
+  FL_BLINE* l = virtual_ ? virtual_line(virtual_lineno(item)) : (FL_BLINE*)item;
   char* str = l->txt;
   const int* i = column_widths();
 
@@ -600,11 +822,15 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
 : Fl_Browser_(X, Y, W, H, L) {
   column_widths_ = no_columns;
   lines = 0;
-  full_height_ = 0;
-  cacheline = 0;
+  virtual_ = 0;
   format_char_ = '@';
   column_char_ = '\t';
-  first = last = cache = 0;
+  first = last = 0;
+  items_ = 0;
+  items_alloc_ = 0;
+  numbered_ = 0;
+  heights_ = 0;
+  heights_valid_ = 0;
 }
 
 /**
@@ -616,13 +842,9 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
 void Fl_Browser::lineposition(int line, Fl_Line_Position pos) {
   if (line<1) line = 1;
   if (line>lines) line = lines;
-  int p = 0;
-
-  FL_BLINE* l;
-  for (l=first; l && line>1; l = l->next) {
-    line--; p += item_height(l);
-  }
-  if (l && (pos == BOTTOM)) p += item_height (l);
+  void* l = item_at(line);
+  int p = l ? item_position(l) : 0;
+  if (l && (pos == BOTTOM)) p += item_height(l);
 
   int final = p, X, Y, W, H;
   bbox(X, Y, W, H);
@@ -667,11 +889,24 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
     return; // avoid recalculation
   Fl_Browser_::textsize(newSize);
   new_list();
-  full_height_ = 0;
-  if (lines == 0) return;
-  for (FL_BLINE* itm=(FL_BLINE *)item_first(); itm; itm=(FL_BLINE *)item_next(itm)) {
-    full_height_ += item_height(itm);
-  }
+  recalc_heights();
+}
+
+/**
+  Sets the default text font for the lines in the browser to \p font.
+
+  This method recalculates all item heights like textsize(Fl_Fontsize),
+  because the height of a line depends on its font.
+
+  It returns immediately (w/o recalculation) if \p font equals
+  the current textfont().
+*/
+void Fl_Browser::textfont(Fl_Font font) {
+  if (font == textfont())
+    return; // avoid recalculation
+  Fl_Browser_::textfont(font);
+  new_list();
+  recalc_heights();
 }
 
 /**
@@ -679,18 +914,82 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::clear() {
+  if (virtual_) {
+    for (int i = 0; i < VIRTUAL_CACHE; i++) free(virtual_->cache[i]);
+    free(virtual_->selected);
+    free(virtual_);
+    virtual_ = 0;
+  }
   for (FL_BLINE* l = first; l;) {
     FL_BLINE* n = l->next;
     free(l);
     l = n;
   }
-  full_height_ = 0;
   first = 0;
   last = 0;
   lines = 0;
+  numbered_ = 0;
+  free(items_);
+  items_ = 0;
+  items_alloc_ = 0;
+  free(heights_);
+  heights_ = 0;
+  heights_valid_ = 0;
   new_list();
 }
 
+/**
+  Switches the browser to virtual mode with \p size lines.
+
+  In virtual mode the browser does not store any lines. It calls \p cb
+  to get the text of the lines it needs to draw or measure, and keeps a
+  small cache of recently used lines, so that memory use does not grow
+  with the number of lines and setting the size takes constant time.
+  Only the selection state of the lines is stored.
+
+  The text returned by \p cb may contain format characters and columns,
+  just like the text of a normal line. All lines have the same height,
+  which is measured from the first line.
+
+  Call this again with the same or another callback to change the number
+  of lines, or after the text of some lines changed; this discards the
+  cached lines. If the browser shrinks, the scroll position and the
+  selected lines after the end are reset. Call clear() or this method
+  with \p cb == NULL to leave virtual mode.
+
+  Methods that change single lines, like add(), insert(), remove(),
+  text(int, const char*), data(int, void*), icon(int, Fl_Image*),
+  hide(int) and swap(), do nothing in virtual mode, and sort() has no
+  effect. data(int) returns NULL.
+
+  \param[in] size number of lines
+  \param[in] cb callback that returns the text of a line
+  \param[in] data user data passed to \p cb
+*/
+void Fl_Browser::virtual_lines(int size, Fl_Browser_Line_Cb *cb, void *data) {
+  if (!cb || !virtual_) clear();
+  if (!cb) return;
+  if (size < 0) size = 0;
+  if (!virtual_) {
+    virtual_ = (Fl_Browser_Virtual*)calloc(1, sizeof(Fl_Browser_Virtual));
+    virtual_->height = -1;
+  } else {
+    for (int i = 0; i < VIRTUAL_CACHE; i++)
+      if (virtual_->cache[i]) virtual_->cache[i]->line = 0;
+    if (size < lines) {
+      virtual_->nselected = virtual_find(virtual_, size+1);
+      new_list();
+    }
+    if (cb != virtual_->cb || data != virtual_->data || !size)
+      virtual_->height = -1;
+    invalidate_widths();
+  }
+  virtual_->cb = cb;
+  virtual_->data = data;
+  lines = size;
+  redraw();
+}
+
 /**
   Adds a new line to the end of the browser.
 
@@ -743,7 +1042,53 @@ void* Fl_Browser::data(int line) const {
 */
 int Fl_Browser::select(int line, int val) {
   if (line < 1 || line > lines) return 0;
-  return Fl_Browser_::select(find_line(line), val);
+  return Fl_Browser_::select(item_at(line), val);
+}
+
+/**
+  Sets the selection state of the lines \p from to \p to (inclusive)
+  to \p val in a multi-line browser, without doing callbacks.
+
+  This is faster than calling select() for each line, particularly in
+  virtual mode, where the selected lines are inserted into or removed
+  from the list of selected lines in one pass. In browsers that are not
+  of type FL_MULTI_BROWSER, only line \p to is selected or deselected.
+
+  \param[in] from,to the first and the last line (1 based)
+  \param[in] val 1 selects the lines, 0 deselects them
+  \returns 1 if the selection changed, 0 if not
+  \see select(), selected(), deselect()
+*/
+int Fl_Browser::select_range(int from, int to, int val) {
+  if (type() != FL_MULTI_BROWSER) return select(to, val);
+  if (from > to) { int t = from; from = to; to = t; }
+  if (from < 1) from = 1;
+  if (to > lines) to = lines;
+  if (from > to) return 0;
+  int change = 0;
+  if (virtual_) {
+    Fl_Browser_Virtual *v = virtual_;
+    int i = virtual_find(v, from), j = virtual_find(v, to+1);
+    int n = val ? to - from + 1 : 0;  // selected lines in the range afterwards
+    if (j - i == n) return 0;
+    if (v->nselected - (j-i) + n > v->alloc) {
+      v->alloc = v->nselected - (j-i) + n;
+      v->selected = (int*)realloc(v->selected, v->alloc*sizeof(int));
+    }
+    memmove(v->selected+i+n, v->selected+j, (v->nselected-j)*sizeof(int));
+    for (int k = 0; k < n; k++) v->selected[i+k] = from + k;
+    v->nselected += n - (j-i);
+    change = 1;
+  } else {
+    for (int line = from; line <= to; line++) {
+      FL_BLINE *l = find_line(line);
+      if ((!val) == (!(l->flags & SELECTED))) continue;
+      item_select(l, val);
+      change = 1;
+    }
+  }
+  if (change) redraw();
+  return change;
 }
 
 /**
@@ -754,6 +1099,7 @@ int Fl_Browser::select(int line, int val) {
   */
 int Fl_Browser::selected(int line) const {
   if (line < 1 || line > lines) return 0;
+  if (virtual_) return virtual_selected(virtual_, line);
   return find_line(line)->flags & SELECTED;
 }
 
@@ -766,10 +1112,11 @@ int Fl_Browser::selected(int line) const {
   \see show(int), hide(int), display(), visible(), make_visible()
 */
 void Fl_Browser::show(int line) {
+  if (virtual_) return;
   FL_BLINE* t = find_line(line);
   if (t->flags & NOTDISPLAYED) {
     t->flags &= ~NOTDISPLAYED;
-    full_height_ += item_height(t);
+    height_changed(line);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -784,10 +1131,11 @@ void Fl_Browser::show(int line) {
   \see show(int), hide(int), display(), visible(), make_visible()
 */
 void Fl_Browser::hide(int line) {
+  if (virtual_) return;
   FL_BLINE* t = find_line(line);
   if (!(t->flags & NOTDISPLAYED)) {
-    full_height_ -= item_height(t);
     t->flags |= NOTDISPLAYED;
+    height_changed(line);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -831,7 +1179,10 @@ int Fl_Browser::value() const {
 */
 void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
 
-  if ( a == b || !a || !b) return;          // nothing to do
+  if ( a == b || !a || !b || virtual_) return;  // nothing to do
+  int aline = lineno(a);
+  int bline = lineno(b);
+  if (!aline || !bline) return;             // not in this browser
   swapping(a, b);
   FL_BLINE *aprev  = a->prev;
   FL_BLINE *anext  = a->next;
@@ -863,9 +1214,13 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
      if ( bprev ) bprev->next = a; else first = a;
      a->next = bnext;
   }
-  // Disable cache -- we played around with positions
-  cacheline = 0;
-  cache = 0;
+  // exchange the positions in the array of lines
+  items_[aline-1] = b; b->line = aline;
+  items_[bline-1] = a; a->line = bline;
+  if (a->height != b->height) {
+    int first_line = aline < bline ? aline : bline;
+    if (heights_valid_ > first_line-1) heights_valid_ = first_line-1;
+  }
 }
 
 /**
@@ -875,7 +1230,7 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
   \see swap(int,int), item_swap()
 */
 void Fl_Browser::swap(int a, int b) {
-  if (a < 1 || a > lines || b < 1 || b > lines) return;
+  if (a < 1 || a > lines || b < 1 || b > lines || virtual_) return;
   FL_BLINE* ai = find_line(a);
   FL_BLINE* bi = find_line(b);
   swap(ai,bi);
@@ -891,20 +1246,15 @@ void Fl_Browser::swap(int a, int b) {
 */
 void Fl_Browser::icon(int line, Fl_Image* icon) {
 
-  if (line<1 || line > lines) return;
+  if (line<1 || line > lines || virtual_) return;
 
   FL_BLINE* bl = find_line(line);
 
-  int old_h = bl->icon ? bl->icon->h()+2 : 0;   // init with *old* icon height
-  bl->icon = 0;                                 // remove icon, if any
-  int th = item_height(bl);                     // height of text only
-  int new_h = icon ? icon->h()+2 : 0;           // init with *new* icon height
-  if (th > old_h) old_h = th;
-  if (th > new_h) new_h = th;
-  int dh = new_h - old_h;
-  full_height_ += dh;                           // do this *always*
-
+  int old_h = bl->height;                       // init with *old* item height
   bl->icon = icon;                              // set new icon
+  height_changed(line);                         // do this *always*
+  int dh = bl->height - old_h;
+
   if (dh>0) {
     redraw();                                   // icon larger than item? must redraw widget
   } else {
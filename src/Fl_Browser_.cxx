@@ -17,10 +17,13 @@
 #define DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <FL/Fl.H>
 #include <FL/Fl_Widget.H>
 #include <FL/Fl_Browser_.H>
 #include <FL/fl_draw.H>
+#include "flstring.h"
 
 
 // This is the base class for browsers.  To be useful it must be
@@ -56,6 +59,155 @@ static void hscrollbar_callback(Fl_Widget* s, void*) {
   ((Fl_Browser_*)(s->parent()))->hposition(int(((Fl_Scrollbar*)s)->value()));
 }
 
+// The widths of the items drawn so far are kept in a hash table keyed
+// by the item, so each item is measured only once. A count of the items
+// of each width lets full_width() fall back to the next widest item when
+// the widest one is deleted or changed, instead of dropping to zero until
+// every item has been drawn again.
+
+struct Fl_Browser_Widths {
+  void **item;          // hash table of items, 0 = empty slot
+  int *width;           // width of the item in each slot
+  int size;             // number of slots, a power of 2
+  int count;            // number of items in the table
+  int *nwidth;          // number of items of each width
+  int nwidth_size;      // allocated size of nwidth
+  int floor;            // widest width dropped when the table was full
+  Fl_Font font;         // textfont() the widths were measured with
+  Fl_Fontsize fontsize; // textsize() the widths were measured with
+};
+
+// Don't remember more widths than this when scrolling through huge lists:
+#define MAX_WIDTHS (1<<20)
+
+static int width_slot(const void *item, int size) {
+  fl_uintptr_t h = (fl_uintptr_t)item;
+  h ^= h >> 16;
+  return (int)((unsigned)h * 2654435761U) & (size-1);
+}
+
+static int width_find(const Fl_Browser_Widths *c, const void *item) {
+  if (!c->size) return -1;
+  for (int i = width_slot(item, c->size); c->item[i]; i = (i+1) & (c->size-1))
+    if (c->item[i] == item) return i;
+  return -1;
+}
+
+static int width_max(const Fl_Browser_Widths *c) {
+  for (int w = c->nwidth_size-1; w > c->floor; w--)
+    if (c->nwidth[w]) return w;
+  return c->floor;
+}
+
+static void width_clear(Fl_Browser_Widths *c) {
+  if (c->size) memset(c->item, 0, c->size*sizeof(void*));
+  if (c->nwidth_size) memset(c->nwidth, 0, c->nwidth_size*sizeof(int));
+  c->count = 0;
+  c->floor = 0;
+}
+
+// Empty slot i, moving later items of the same run back so that
+// lookups never stop early at the hole:
+static void width_remove(Fl_Browser_Widths *c, int i) {
+  int mask = c->size-1;
+  c->nwidth[c->width[i]]--;
+  c->count--;
+  c->item[i] = 0;
+  for (int j = (i+1) & mask; c->item[j]; j = (j+1) & mask) {
+    int k = width_slot(c->item[j], c->size);
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+    c->item[i] = c->item[j];
+    c->width[i] = c->width[j];
+    c->item[j] = 0;
+    i = j;
+  }
+}
+
+static void width_add(Fl_Browser_Widths *c, void *item, int w) {
+  if (w < 0) w = 0;
+  if (c->count >= MAX_WIDTHS) {
+    int floor = width_max(c);
+    width_clear(c);
+    c->floor = floor;
+  }
+  if (2*(c->count+1) > c->size) {
+    int oldsize = c->size;
+    void **olditem = c->item;
+    int *oldwidth = c->width;
+    c->size = oldsize ? 2*oldsize : 256;
+    c->item = (void**)calloc(c->size, sizeof(void*));
+    c->width = (int*)malloc(c->size*sizeof(int));
+    for (int i = 0; i < oldsize; i++) if (olditem[i]) {
+      int j = width_slot(olditem[i], c->size);
+      while (c->item[j]) j = (j+1) & (c->size-1);
+      c->item[j] = olditem[i];
+      c->width[j] = oldwidth[i];
+    }
+    free(olditem);
+    free(oldwidth);
+  }
+  if (w >= c->nwidth_size) {
+    int n = c->nwidth_size ? 2*c->nwidth_size : 1024;
+    while (n <= w) n *= 2;
+    c->nwidth = (int*)realloc(c->nwidth, n*sizeof(int));
+    memset(c->nwidth+c->nwidth_size, 0, (n-c->nwidth_size)*sizeof(int));
+    c->nwidth_size = n;
+  }
+  int i = width_slot(item, c->size);
+  while (c->item[i]) i = (i+1) & (c->size-1);
+  c->item[i] = item;
+  c->width[i] = w;
+  c->nwidth[w]++;
+  c->count++;
+}
+
+/**
+  \internal
+  Returns the width of \p item, measuring it with item_width() only if
+  it has not been measured since it last changed, and updates full_width().
+*/
+int Fl_Browser_::cached_width(void *item) {
+  Fl_Browser_Widths *c = widths_;
+  if (!c) {
+    c = widths_ = (Fl_Browser_Widths*)calloc(1, sizeof(Fl_Browser_Widths));
+    c->font = textfont();
+    c->fontsize = textsize();
+  }
+  int i = width_find(c, item);
+  if (i >= 0) return c->width[i];
+  int ww = item_width(item);
+  width_add(c, item, ww);
+  if (ww > max_width) max_width = ww;
+  return ww;
+}
+
+/**
+  \internal
+  Drops the cached width of \p item, if any. If it was the widest item,
+  full_width() falls back to the widest of the remaining measured items.
+*/
+void Fl_Browser_::forget_width(void *item) {
+  Fl_Browser_Widths *c = widths_;
+  if (!c) return;
+  int i = width_find(c, item);
+  if (i < 0) return;
+  int ww = c->width[i];
+  width_remove(c, i);
+  if (ww >= max_width) max_width = width_max(c);
+}
+
+/**
+  This method should be called when the widths of the items may have
+  changed for a reason the Fl_Browser_ cannot see, for instance a change
+  of the column widths in a subclass. The items are measured again when
+  they are next drawn.
+  Changes of textfont() and textsize() are detected automatically.
+*/
+void Fl_Browser_::invalidate_widths() {
+  if (widths_) width_clear(widths_);
+  max_width = 0;
+}
+
 // return where to draw the actual box:
 /**
   Returns the bounding box for the interior of the list's display window, inside
@@ -111,7 +263,7 @@ void Fl_Browser_::resize(int X, int Y, int W, int H) {
   hscrollbar.resize(
         X, scrollbar.align()&FL_ALIGN_TOP ? Y-scrollsize : Y+H,
         W, scrollsize);
-  max_width = 0;
+  // item widths don't depend on the size, keep the cached widths
 }
 
 // Cause minimal update to redraw the given item:
@@ -134,8 +286,11 @@ void Fl_Browser_::update_top() {
     void* l;
     int ly;
     int yy = position_;
-    // start from either head or current position, whichever is closer:
-    if (!top_ || yy <= (real_position_/2)) {
+    // ask the subclass, or start from either head or current position,
+    // whichever is closer:
+    if ((l = item_at_position(yy, ly))) {
+      // found it
+    } else if (!top_ || yy <= (real_position_/2)) {
       l = item_first();
       ly = 0;
     } else {
@@ -258,6 +413,25 @@ void Fl_Browser_::display(void* item) {
   void* lp = item_prev(l);
   if (lp == item) {position(real_position_+Y-item_quick_height(lp)); return;}
 
+  // if the subclass knows where the item is, there is no need to search:
+  int ip = item_position(item);
+  if (ip >= 0) {
+    h1 = item_quick_height(item);
+    Y = ip - real_position_;
+    if (ip >= real_position_ - offset_) { // below the top item
+      if (Y <= H) { // it is visible or right at bottom
+        Y = Y+h1-H; // find where bottom edge is
+        if (Y > 0) position(real_position_+Y); // scroll down a bit
+      } else {
+        position(real_position_+Y-(H-h1)/2); // center it
+      }
+    } else { // above the top item
+      if ((Y + h1) >= 0) position(real_position_+Y);
+      else position(real_position_+Y-(H-h1)/2);
+    }
+    return;
+  }
+
 #ifdef DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
   // search for item.  We search both up and down the list at the same time,
   // this evens up the execution time for the two cases - the old way was
@@ -326,6 +500,11 @@ void Fl_Browser_::display(void* item) {
 */
 void Fl_Browser_::draw() {
   int drawsquare = 0;
+  if (widths_ && (widths_->font != textfont() || widths_->fontsize != textsize())) {
+    invalidate_widths();
+    widths_->font = textfont();
+    widths_->fontsize = textsize();
+  }
   update_top();
   int full_width_ = full_width();
   int full_height_ = full_height();
@@ -410,8 +589,7 @@ J1:
         draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
         draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
       }
-      int ww = item_width(l);
-      if (ww > max_width) {max_width = ww; max_width_item = l;}
+      cached_width(l);
     }
     yy += hh;
   }
@@ -491,8 +669,7 @@ void Fl_Browser_::new_list() {
   hposition_ = real_hposition_ = 0;
   selection_ = 0;
   offset_ = 0;
-  max_width = 0;
-  max_width_item = 0;
+  invalidate_widths();
   redraw_lines();
 }
 
@@ -521,7 +698,7 @@ void Fl_Browser_::deleting(void* item) {
     top_ = 0;
   }
   if (item == selection_) selection_ = 0;
-  if (item == max_width_item) {max_width_item = 0; max_width = 0;}
+  forget_width(item);
 }
 
 /**
@@ -537,7 +714,7 @@ void Fl_Browser_::replacing(void* a, void* b) {
   redraw_line(a);
   if (a == selection_) selection_ = b;
   if (a == top_) top_ = b;
-  if (a == max_width_item) {max_width_item = 0; max_width = 0;}
+  forget_width(a);
 }
 
 /**
@@ -973,57 +1150,161 @@ Fl_Browser_::Fl_Browser_(int X, int Y, int W, int H, const char* L)
   textcolor_ = FL_FOREGROUND_COLOR;
   has_scrollbar_ = BOTH;
   max_width = 0;
-  max_width_item = 0;
+  widths_ = 0;
   scrollbar_size_ = 0;
   redraw1 = redraw2 = 0;
   end();
 }
 
+/**
+  Destroys the browser and the cached item widths.
+  The items themselves belong to the subclass.
+*/
+Fl_Browser_::~Fl_Browser_() {
+  if (widths_) {
+    free(widths_->item);
+    free(widths_->width);
+    free(widths_->nwidth);
+    free(widths_);
+  }
+}
+
+// Compares two strings like fl_numericsort() compares file names:
+// sequences of digits are compared by their numeric value.
+static int numeric_compare(const char *a, const char *b, int cs) {
+  for (;;) {
+    if (isdigit(*a & 255) && isdigit(*b & 255)) {
+      int diff, magdiff;
+      while (*a == '0') a++;
+      while (*b == '0') b++;
+      while (isdigit(*a & 255) && *a == *b) {a++; b++;}
+      diff = (isdigit(*a & 255) && isdigit(*b & 255)) ? *a - *b : 0;
+      magdiff = 0;
+      while (isdigit(*a & 255)) {magdiff++; a++;}
+      while (isdigit(*b & 255)) {magdiff--; b++;}
+      if (magdiff) return magdiff;      // compare # of significant digits
+      if (diff) return diff;            // compare first non-zero digit
+    } else {
+      int ret = cs ? (*a & 255) - (*b & 255)
+                   : tolower(*a & 255) - tolower(*b & 255);
+      if (ret || !*a) return ret;
+      a++; b++;
+    }
+  }
+}
+
+static int case_compare(const char *a, const char *b) {
+  return fl_ascii_strcasecmp(a, b);
+}
+
+static int case_numeric_compare(const char *a, const char *b) {
+  return numeric_compare(a, b, 0);
+}
+
+static int cs_numeric_compare(const char *a, const char *b) {
+  return numeric_compare(a, b, 1);
+}
+
 /**
   Sort the items in the browser based on \p flags.
   item_swap(void*, void*) and item_text(void*) must be implemented for this call.
+
+  The sort is stable: items that compare equal keep their order.
+  It takes O(n log n) comparisons and at most n-1 calls of item_swap().
+
   \param[in] flags FL_SORT_ASCENDING -- sort in ascending order\n
                    FL_SORT_DESCENDING -- sort in descending order\n
+                   FL_SORT_CASEINSENSITIVE -- ignore case\n
+                   FL_SORT_NUMERIC -- compare numbers by value,
+                   so that "file9" sorts before "file10"\n
                    Values other than the above will cause undefined behavior\n
                    Other flags may appear in the future.
-  \todo Add a flag to ignore case
+  \see sort(int, Fl_Browser_Sort_F*)
 */
 void Fl_Browser_::sort(int flags) {
-  //
-  // Simple bubble sort - pure lazyness on my side.
-  //
-  int i, j, n = -1, desc = ((flags&FL_SORT_DESCENDING)==FL_SORT_DESCENDING);
-  void *a =item_first(), *b, *c;
-  if (!a) return;
-  while (a) {
-    a = item_next(a);
-    n++;
+  Fl_Browser_Sort_F *compare = strcmp;
+  if (flags & FL_SORT_NUMERIC)
+    compare = (flags & FL_SORT_CASEINSENSITIVE) ? case_numeric_compare : cs_numeric_compare;
+  else if (flags & FL_SORT_CASEINSENSITIVE)
+    compare = case_compare;
+  sort(flags, compare);
+}
+
+/**
+  Sort the items in the browser with the comparison function \p compare.
+
+  \p compare is called with the item_text() of two items, NULL texts are
+  passed as empty strings. Only the FL_SORT_DESCENDING bit of \p flags is
+  used, which reverses the order. This can be used for instance to sort
+  by a column of the text:
+  \code
+  static int compare_second_column(const char *a, const char *b) {
+    const char *ta = strchr(a, '\t'), *tb = strchr(b, '\t');
+    return strcmp(ta ? ta+1 : "", tb ? tb+1 : "");
   }
-  for (i=n; i>0; i--) {
-    char swapped = 0;
-    a = item_first();
-    b = item_next(a);
-    for (j=0; j<i; j++) {
-      const char *ta = item_text(a);
-      const char *tb = item_text(b);
-      c = item_next(b);
-      if (desc) {
-        if (strcmp(ta, tb)<0) {
-          item_swap(a, b);
-          swapped = 1;
-        }
-      } else {
-        if (strcmp(ta, tb)>0) {
-          item_swap(a, b);
-          swapped = 1;
-        }
+  ...
+  browser->sort(FL_SORT_ASCENDING, compare_second_column);
+  \endcode
+
+  Does nothing if sortable() returns 0.
+
+  \param[in] flags FL_SORT_ASCENDING or FL_SORT_DESCENDING
+  \param[in] compare the comparison function
+  \see sort(int), sortable()
+*/
+void Fl_Browser_::sort(int flags, Fl_Browser_Sort_F *compare) {
+  if (!sortable()) return;
+  int desc = ((flags&FL_SORT_DESCENDING)==FL_SORT_DESCENDING);
+  int i, n = 0;
+  void *a;
+  for (a = item_first(); a; a = item_next(a)) n++;
+  if (n < 2) return;
+
+  // collect the items and their texts:
+  void **items = (void**)malloc(n * sizeof(void*));
+  const char **text = (const char**)malloc(n * sizeof(const char*));
+  int *buf = (int*)malloc(4 * n * sizeof(int));
+  int *order = buf, *tmp = buf + n;
+  for (a = item_first(), i = 0; a; a = item_next(a), i++) {
+    items[i] = a;
+    text[i] = item_text(a);
+    if (!text[i]) text[i] = "";
+    order[i] = i;
+  }
+
+  // bottom-up merge sort of the item indexes, which keeps equal items in order:
+  for (int width = 1; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2*width) {
+      int mid = lo + width, hi = lo + 2*width;
+      if (mid > n) mid = n;
+      if (hi > n) hi = n;
+      int l = lo, r = mid, k = lo;
+      while (l < mid && r < hi) {
+        int c = compare(text[order[l]], text[order[r]]);
+        if (desc ? c < 0 : c > 0) tmp[k++] = order[r++];
+        else tmp[k++] = order[l++];
       }
-      if (!c) break;
-      b = c; a = item_prev(b);
+      while (l < mid) tmp[k++] = order[l++];
+      while (r < hi) tmp[k++] = order[r++];
     }
-    if (!swapped)
-      break;
+    int *t = order; order = tmp; tmp = t;
+  }
+
+  // move the items into place, swapping each one at most once:
+  int *cur = buf + 2*n;         // original index of the item at a position
+  int *where = buf + 3*n;       // position of the item with an original index
+  for (i = 0; i < n; i++) cur[i] = where[i] = i;
+  for (i = 0; i < n; i++) {
+    int j = order[i], p = where[j];
+    if (p == i) continue;
+    item_swap(items[cur[i]], items[j]);
+    cur[p] = cur[i]; where[cur[i]] = p;
+    cur[i] = j; where[j] = i;
   }
+
+  free(buf);
+  free(text);
+  free(items);
 }
 
 // Default versions of some of the virtual functions:
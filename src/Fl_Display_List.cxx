@@ -0,0 +1,356 @@
+//
+// Retained drawing of static widgets for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Display_List.H"
+#include <FL/Fl_Graphics_Driver.H>
+#include <FL/fl_draw.H>
+#include <stdlib.h>
+#include <string.h>
+
+// Opcodes of the display list, each followed by its int arguments
+enum {
+  OP_POINT,             // x y
+  OP_RECT,              // x y w h
+  OP_RECTF,             // x y w h
+  OP_LINE,              // x y x1 y1
+  OP_LINE3,             // x y x1 y1 x2 y2
+  OP_XYLINE,            // x y x1
+  OP_XYLINE2,           // x y x1 y2
+  OP_XYLINE3,           // x y x1 y2 x3
+  OP_YXLINE,            // x y y1
+  OP_YXLINE2,           // x y y1 x2
+  OP_YXLINE3,           // x y y1 x2 y3
+  OP_LOOP,              // x0 y0 x1 y1 x2 y2
+  OP_LOOP4,             // x0 y0 x1 y1 x2 y2 x3 y3
+  OP_POLYGON,           // x0 y0 x1 y1 x2 y2
+  OP_POLYGON4,          // x0 y0 x1 y1 x2 y2 x3 y3
+  OP_ARC,               // x y w h a1 a2 (angles in 1/1000 degrees)
+  OP_PIE,               // x y w h a1 a2 (angles in 1/1000 degrees)
+  OP_PUSH_CLIP,         // x y w h
+  OP_PUSH_NO_CLIP,
+  OP_POP_CLIP,
+  OP_COLOR,             // Fl_Color
+  OP_COLOR_RGB,         // r g b
+  OP_FONT,              // face size
+  OP_LINE_STYLE,        // style width
+  OP_DRAW               // text offset, length, x y
+};
+
+static Fl_Display_List *recording = 0; // the list between begin() and end()
+
+/*
+ A graphics driver that appends the operations it receives to an
+ Fl_Display_List. Text measurements are answered by the driver that was
+ current when recording began, so that label layout is the same as when
+ drawing directly. Operations that cannot be recorded mark the list as
+ failed.
+ */
+class Fl_Recording_Graphics_Driver : public Fl_Graphics_Driver {
+  Fl_Display_List *list_;
+  Fl_Graphics_Driver *real_;
+  void rec(int op, int n, const int *a) {
+    if (list_->status_ == Fl_Display_List::FAILED) return;
+    int *p = list_->add(op, n);
+    if (p) memcpy(p, a, n * sizeof(int));
+    else fail();
+  }
+  void fail() { list_->status_ = Fl_Display_List::FAILED; }
+protected:
+  void draw_image(const uchar*, int, int, int, int, int, int) { fail(); }
+  void draw_image_mono(const uchar*, int, int, int, int, int, int) { fail(); }
+  void draw_image(Fl_Draw_Image_Cb, void*, int, int, int, int, int) { fail(); }
+  void draw_image_mono(Fl_Draw_Image_Cb, void*, int, int, int, int, int) { fail(); }
+  void draw_rgb(Fl_RGB_Image*, int, int, int, int, int, int) { fail(); }
+  void draw_pixmap(Fl_Pixmap*, int, int, int, int, int, int) { fail(); }
+  void draw_bitmap(Fl_Bitmap*, int, int, int, int, int, int) { fail(); }
+  void copy_offscreen(int, int, int, int, Fl_Offscreen, int, int) { fail(); }
+public:
+  Fl_Recording_Graphics_Driver(Fl_Display_List *list, Fl_Graphics_Driver *real)
+  : list_(list), real_(real) {
+    Fl_Graphics_Driver::scale(real->scale());
+    color_ = real->color();
+    font_ = real->font();
+    size_ = real->size();
+  }
+  void point(int x, int y) { int a[] = {x, y}; rec(OP_POINT, 2, a); }
+  void rect(int x, int y, int w, int h) { int a[] = {x, y, w, h}; rec(OP_RECT, 4, a); }
+  void rectf(int x, int y, int w, int h) { int a[] = {x, y, w, h}; rec(OP_RECTF, 4, a); }
+  void line(int x, int y, int x1, int y1) {
+    int a[] = {x, y, x1, y1}; rec(OP_LINE, 4, a);
+  }
+  void line(int x, int y, int x1, int y1, int x2, int y2) {
+    int a[] = {x, y, x1, y1, x2, y2}; rec(OP_LINE3, 6, a);
+  }
+  void xyline(int x, int y, int x1) { int a[] = {x, y, x1}; rec(OP_XYLINE, 3, a); }
+  void xyline(int x, int y, int x1, int y2) {
+    int a[] = {x, y, x1, y2}; rec(OP_XYLINE2, 4, a);
+  }
+  void xyline(int x, int y, int x1, int y2, int x3) {
+    int a[] = {x, y, x1, y2, x3}; rec(OP_XYLINE3, 5, a);
+  }
+  void yxline(int x, int y, int y1) { int a[] = {x, y, y1}; rec(OP_YXLINE, 3, a); }
+  void yxline(int x, int y, int y1, int x2) {
+    int a[] = {x, y, y1, x2}; rec(OP_YXLINE2, 4, a);
+  }
+  void yxline(int x, int y, int y1, int x2, int y3) {
+    int a[] = {x, y, y1, x2, y3}; rec(OP_YXLINE3, 5, a);
+  }
+  void loop(int x0, int y0, int x1, int y1, int x2, int y2) {
+    int a[] = {x0, y0, x1, y1, x2, y2}; rec(OP_LOOP, 6, a);
+  }
+  void loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {
+    int a[] = {x0, y0, x1, y1, x2, y2, x3, y3}; rec(OP_LOOP4, 8, a);
+  }
+  void polygon(int x0, int y0, int x1, int y1, int x2, int y2) {
+    int a[] = {x0, y0, x1, y1, x2, y2}; rec(OP_POLYGON, 6, a);
+  }
+  void polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {
+    int a[] = {x0, y0, x1, y1, x2, y2, x3, y3}; rec(OP_POLYGON4, 8, a);
+  }
+  void arc(int x, int y, int w, int h, double a1, double a2) {
+    int a[] = {x, y, w, h, int(a1 * 1000), int(a2 * 1000)}; rec(OP_ARC, 6, a);
+  }
+  void pie(int x, int y, int w, int h, double a1, double a2) {
+    int a[] = {x, y, w, h, int(a1 * 1000), int(a2 * 1000)}; rec(OP_PIE, 6, a);
+  }
+  // everything is recorded; clipping is done when the list is replayed
+  void push_clip(int x, int y, int w, int h) { int a[] = {x, y, w, h}; rec(OP_PUSH_CLIP, 4, a); }
+  void push_no_clip() { rec(OP_PUSH_NO_CLIP, 0, 0); }
+  void pop_clip() { rec(OP_POP_CLIP, 0, 0); }
+  Fl_Region clip_region() { return 0; }
+  void clip_region(Fl_Region r) { if (r) fail(); }
+  void restore_clip() {}
+  void begin_points() { fail(); }
+  void begin_line() { fail(); }
+  void begin_loop() { fail(); }
+  void begin_polygon() { fail(); }
+  void begin_complex_polygon() { fail(); }
+  // the base class would store the vertices of the failed path
+  void vertex(double, double) {}
+  void transformed_vertex(double, double) {}
+  void gap() {}
+  void end_points() {}
+  void end_line() {}
+  void end_loop() {}
+  void end_polygon() {}
+  void end_complex_polygon() {}
+  void circle(double, double, double) { fail(); }
+  void arc(double, double, double, double, double) { fail(); }
+  void curve(double, double, double, double, double, double, double, double) { fail(); }
+  void overlay_rect(int, int, int, int) { fail(); }
+  void line_style(int style, int width = 0, char *dashes = 0) {
+    if (dashes && *dashes) { fail(); return; }
+    int a[] = {style, width}; rec(OP_LINE_STYLE, 2, a);
+  }
+  void color(Fl_Color c) { color_ = c; int a[] = {int(c)}; rec(OP_COLOR, 1, a); }
+  void color(uchar r, uchar g, uchar b) {
+    color_ = fl_rgb_color(r, g, b);
+    int a[] = {r, g, b}; rec(OP_COLOR_RGB, 3, a);
+  }
+  Fl_Color color() { return color_; }
+  void font(Fl_Font face, Fl_Fontsize fsize) {
+    font_ = face; size_ = fsize;
+    real_->font(face, fsize);
+    int a[] = {face, fsize}; rec(OP_FONT, 2, a);
+  }
+  void draw(const char *str, int n, int x, int y) {
+    if (list_->status_ == Fl_Display_List::FAILED) return;
+    int t = list_->add_text(str, n);
+    if (t < 0) { fail(); return; }
+    int a[] = {t, n, x, y}; rec(OP_DRAW, 4, a);
+  }
+  void draw(int angle, const char *str, int n, int x, int y) {
+    if (angle) fail(); else draw(str, n, x, y);
+  }
+  void rtl_draw(const char*, int, int, int) { fail(); }
+  int has_feature(driver_feature feature) { return real_->has_feature(feature); }
+  char can_do_alpha_blending() { return real_->can_do_alpha_blending(); }
+  double width(const char *str, int n) { return real_->width(str, n); }
+  double width(unsigned int c) { return real_->width(c); }
+  void text_extents(const char *str, int n, int &dx, int &dy, int &w, int &h) {
+    real_->text_extents(str, n, dx, dy, w, h);
+  }
+  int height() { return real_->height(); }
+  int descent() { return real_->descent(); }
+};
+
+
+Fl_Display_List::Fl_Display_List() {
+  memset(&key_, 0, sizeof(key_));
+  status_ = EMPTY;
+  X_ = Y_ = 0;
+  ops_ = 0; nops_ = aops_ = 0;
+  text_ = 0; ntext_ = atext_ = 0;
+  saved_driver_ = 0;
+}
+
+Fl_Display_List::~Fl_Display_List() {
+  if (saved_driver_) end();
+  free(ops_);
+  free(text_);
+}
+
+/** Forgets the recorded operations. */
+void Fl_Display_List::clear() {
+  status_ = EMPTY;
+  nops_ = ntext_ = 0;
+}
+
+// Sums up everything that changes how widget w draws itself, except its position.
+// The state argument holds widget flags that have no public accessor.
+void Fl_Display_List::make_key(const Fl_Widget *w, int state, Key &k) const {
+  memset(&k, 0, sizeof(k)); // also clears padding for memcmp()
+  k.w = w->w();
+  k.h = w->h();
+  k.box = w->box();
+  k.boxf = Fl::get_boxtype(w->box());
+  k.align = w->align();
+  k.color = w->color();
+  k.rgb = Fl::get_color(w->color());
+  k.labeltype = w->labeltype();
+  k.labelfont = w->labelfont();
+  k.labelsize = w->labelsize();
+  k.labelcolor = w->labelcolor();
+  k.label = w->label();
+  unsigned hash = 2166136261U;
+  for (const char *p = k.label; p && *p; p++) hash = (hash ^ (uchar)*p) * 16777619U;
+  k.hash = hash;
+  k.image = w->image();
+  k.deimage = w->deimage();
+  k.state = (state << 1) | (w->active_r() ? 1 : 0);
+  k.scheme = Fl::scheme();
+  k.scale = fl_graphics_driver->scale();
+}
+
+/**
+ Returns non-zero if the list was made for the current appearance of \p w,
+ whether its recording succeeded or not.
+ */
+int Fl_Display_List::valid(const Fl_Widget *w, int state) const {
+  if (status_ == EMPTY) return 0;
+  Key k;
+  make_key(w, state, k);
+  return !memcmp(&k, &key_, sizeof(k));
+}
+
+/**
+ Starts recording the drawing of widget \p w.
+ Returns 0 if recording is not possible, for instance because another
+ list is being recorded; end() must not be called in that case.
+ */
+int Fl_Display_List::begin(const Fl_Widget *w, int state) {
+  if (recording || !fl_graphics_driver) return 0;
+  recording = this;
+  make_key(w, state, key_);
+  X_ = w->x();
+  Y_ = w->y();
+  nops_ = ntext_ = 0;
+  status_ = RECORDED;
+  saved_driver_ = fl_graphics_driver;
+  fl_graphics_driver = new Fl_Recording_Graphics_Driver(this, saved_driver_);
+  return 1;
+}
+
+/** Stops recording and restores the graphics driver. */
+void Fl_Display_List::end() {
+  delete fl_graphics_driver;
+  fl_graphics_driver = saved_driver_;
+  saved_driver_ = 0;
+  recording = 0;
+  if (status_ == FAILED) nops_ = ntext_ = 0;
+}
+
+// Appends an opcode and returns where its nargs arguments go, or NULL when out of memory.
+int *Fl_Display_List::add(int op, int nargs) {
+  if (nops_ + 1 + nargs > aops_) {
+    int n = aops_ ? 2 * aops_ : 64;
+    while (n < nops_ + 1 + nargs) n *= 2;
+    int *p = (int*)realloc(ops_, n * sizeof(int));
+    if (!p) return 0;
+    ops_ = p; aops_ = n;
+  }
+  int *p = ops_ + nops_;
+  *p = op;
+  nops_ += 1 + nargs;
+  return p + 1;
+}
+
+// Copies n bytes of text into the list and returns their offset, or -1 when out of memory.
+int Fl_Display_List::add_text(const char *str, int n) {
+  if (ntext_ + n > atext_) {
+    int a = atext_ ? 2 * atext_ : 256;
+    while (a < ntext_ + n) a *= 2;
+    char *p = (char*)realloc(text_, a);
+    if (!p) return -1;
+    text_ = p; atext_ = a;
+  }
+  memcpy(text_ + ntext_, str, n);
+  ntext_ += n;
+  return ntext_ - n;
+}
+
+/**
+ Draws the recorded operations, moved to widget position \p X, \p Y.
+ Returns 0 without drawing anything if there is no successful recording.
+ */
+int Fl_Display_List::replay(int X, int Y) const {
+  if (status_ != RECORDED) return 0;
+  int dx = X - X_, dy = Y - Y_;
+  const int *p = ops_, *e = ops_ + nops_;
+  while (p < e) {
+    const int *a = p + 1;
+    switch (*p) {
+      case OP_POINT: fl_point(a[0]+dx, a[1]+dy); p = a + 2; break;
+      case OP_RECT: fl_rect(a[0]+dx, a[1]+dy, a[2], a[3]); p = a + 4; break;
+      case OP_RECTF: fl_rectf(a[0]+dx, a[1]+dy, a[2], a[3]); p = a + 4; break;
+      case OP_LINE: fl_line(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy); p = a + 4; break;
+      case OP_LINE3:
+        fl_line(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx, a[5]+dy); p = a + 6; break;
+      case OP_XYLINE: fl_xyline(a[0]+dx, a[1]+dy, a[2]+dx); p = a + 3; break;
+      case OP_XYLINE2: fl_xyline(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy); p = a + 4; break;
+      case OP_XYLINE3:
+        fl_xyline(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx); p = a + 5; break;
+      case OP_YXLINE: fl_yxline(a[0]+dx, a[1]+dy, a[2]+dy); p = a + 3; break;
+      case OP_YXLINE2: fl_yxline(a[0]+dx, a[1]+dy, a[2]+dy, a[3]+dx); p = a + 4; break;
+      case OP_YXLINE3:
+        fl_yxline(a[0]+dx, a[1]+dy, a[2]+dy, a[3]+dx, a[4]+dy); p = a + 5; break;
+      case OP_LOOP:
+        fl_loop(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx, a[5]+dy); p = a + 6; break;
+      case OP_LOOP4:
+        fl_loop(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx, a[5]+dy, a[6]+dx, a[7]+dy);
+        p = a + 8; break;
+      case OP_POLYGON:
+        fl_polygon(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx, a[5]+dy); p = a + 6; break;
+      case OP_POLYGON4:
+        fl_polygon(a[0]+dx, a[1]+dy, a[2]+dx, a[3]+dy, a[4]+dx, a[5]+dy, a[6]+dx, a[7]+dy);
+        p = a + 8; break;
+      case OP_ARC:
+        fl_arc(a[0]+dx, a[1]+dy, a[2], a[3], a[4] / 1000.0, a[5] / 1000.0); p = a + 6; break;
+      case OP_PIE:
+        fl_pie(a[0]+dx, a[1]+dy, a[2], a[3], a[4] / 1000.0, a[5] / 1000.0); p = a + 6; break;
+      case OP_PUSH_CLIP: fl_push_clip(a[0]+dx, a[1]+dy, a[2], a[3]); p = a + 4; break;
+      case OP_PUSH_NO_CLIP: fl_push_no_clip(); p = a; break;
+      case OP_POP_CLIP: fl_pop_clip(); p = a; break;
+      case OP_COLOR: fl_color(Fl_Color(a[0])); p = a + 1; break;
+      case OP_COLOR_RGB: fl_color(uchar(a[0]), uchar(a[1]), uchar(a[2])); p = a + 3; break;
+      case OP_FONT: fl_font(Fl_Font(a[0]), Fl_Fontsize(a[1])); p = a + 2; break;
+      case OP_LINE_STYLE: fl_line_style(a[0], a[1]); p = a + 2; break;
+      case OP_DRAW: fl_draw(text_ + a[0], a[1], a[2]+dx, a[3]+dy); p = a + 4; break;
+      default: return 1; // cannot happen
+    }
+  }
+  return 1;
+}
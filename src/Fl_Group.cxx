@@ -25,6 +25,8 @@
 #include <FL/fl_draw.H>
 
 #include <stdlib.h> // malloc etc.
+#include <string.h> // memset
+#include <math.h>   // sqrt
 
 Fl_Group* Fl_Group::current_;
 
@@ -141,10 +143,205 @@ static int navkey() {
   return 0;
 }
 
+// Spatial index of the children of a group, see Fl_Group::spatial_index(int).
+//
+// The bounding box of the children is divided into a grid of equal cells,
+// about one cell per child. Each cell lists the indexes of the children
+// overlapping it in increasing order, so the children at a point are found
+// by looking at a single cell. Children with labels outside of their bounds
+// or without a size are listed in 'outside' instead, because they may have
+// to be drawn even if their bounds are clipped.
+
+class Fl_Group_Index {
+public:
+  int valid;            // 0 if children were added, removed or moved
+  int X, Y, W, H;       // bounding box of the children
+  int cw, ch;           // cell size
+  int cols, rows;       // number of cells, 0 if no child has a size
+  int *start;           // children of cell c: items[start[c]..start[c+1]-1]
+  int *items;
+  int *outside;         // children with outside labels or without a size
+  int noutside;
+  int *found;           // children found by Fl_Group::children_in_clip()
+  int *stamp;           // per child: 'gen' if already in 'found'
+  int gen;
+  int alloc;            // number of children allocated for
+
+  Fl_Group_Index() {
+    valid = 0;
+    X = Y = W = H = 0;
+    cw = ch = 1;
+    cols = rows = 0;
+    start = items = outside = found = stamp = 0;
+    noutside = gen = alloc = 0;
+  }
+  ~Fl_Group_Index() {
+    free(start); free(items); free(outside); free(found); free(stamp);
+  }
+  void build(Fl_Widget*const* a, int n);
+  int cells(Fl_Widget *o, int &c0, int &c1, int &r0, int &r1) const;
+};
+
+void Fl_Group_Index::build(Fl_Widget*const* a, int n) {
+  valid = 1;
+  if (n > alloc) {
+    alloc = n;
+    outside = (int*)realloc(outside, alloc * sizeof(int));
+    found = (int*)realloc(found, alloc * sizeof(int));
+    stamp = (int*)realloc(stamp, alloc * sizeof(int));
+    memset(stamp, 0, alloc * sizeof(int));
+    gen = 0;
+  }
+  // find the bounding box of the children, and the 'outside' children
+  int i, L = 0, T = 0, R = 0, B = 0, first = 1;
+  noutside = 0;
+  for (i = 0; i < n; i++) {
+    Fl_Widget *o = a[i];
+    int sized = o->w() > 0 && o->h() > 0;
+    if (!sized || ((o->align() & 15) && !(o->align() & FL_ALIGN_INSIDE)))
+      outside[noutside++] = i;
+    if (!sized) continue;
+    if (first || o->x() < L) L = o->x();
+    if (first || o->y() < T) T = o->y();
+    if (first || o->x() + o->w() > R) R = o->x() + o->w();
+    if (first || o->y() + o->h() > B) B = o->y() + o->h();
+    first = 0;
+  }
+  X = L; Y = T; W = R - L; H = B - T;
+  cols = rows = 0;
+  if (first) return; // no child has a size
+  // about one cell per child, but not smaller than 8x8 pixels
+  double side = sqrt((double)W * H / n);
+  if (side < 8) side = 8;
+  cw = (int)side; ch = (int)side;
+  if (cw > W) cw = W;
+  if (ch > H) ch = H;
+  cols = (W + cw - 1) / cw;
+  rows = (H + ch - 1) / ch;
+  int ncells = cols * rows;
+  start = (int*)realloc(start, (ncells + 1) * sizeof(int));
+  memset(start, 0, (ncells + 1) * sizeof(int));
+  int c, r, c0, c1, r0, r1;
+  // count the children of each cell
+  for (i = 0; i < n; i++) {
+    if (!cells(a[i], c0, c1, r0, r1)) continue;
+    for (r = r0; r <= r1; r++)
+      for (c = c0; c <= c1; c++) start[r * cols + c]++;
+  }
+  // make start[c] the end of cell c, then fill the cells backwards, so
+  // that they list their children in increasing order and start[c]
+  // becomes the beginning of cell c
+  for (c = 1; c < ncells; c++) start[c] += start[c-1];
+  start[ncells] = start[ncells-1];
+  items = (int*)realloc(items, (start[ncells] + 1) * sizeof(int));
+  for (i = n; i--;) {
+    if (!cells(a[i], c0, c1, r0, r1)) continue;
+    for (r = r0; r <= r1; r++)
+      for (c = c0; c <= c1; c++) items[--start[r * cols + c]] = i;
+  }
+}
+
+// Finds the columns c0..c1 and rows r0..r1 of the cells overlapped by the
+// widget. Returns 0 if the widget has no size.
+int Fl_Group_Index::cells(Fl_Widget *o, int &c0, int &c1, int &r0, int &r1) const {
+  if (o->w() <= 0 || o->h() <= 0) return 0;
+  c0 = (o->x() - X) / cw;
+  c1 = (o->x() + o->w() - 1 - X) / cw;
+  r0 = (o->y() - Y) / ch;
+  r1 = (o->y() + o->h() - 1 - Y) / ch;
+  return 1;
+}
+
+// Marks the spatial index for rebuilding, after children were added,
+// removed or moved.
+void Fl_Group::invalidate_index() {
+  if (index_) index_->valid = 0;
+}
+
+/**
+  Enables or disables a spatial index of the children of the group.
+
+  Without the index, the group tests every child to find the one below
+  the mouse for FL_PUSH, FL_MOVE, FL_DND_DRAG and similar events, and to
+  find the children to draw. This is slow for groups with thousands of
+  children. With the index, only the children near the mouse, or inside
+  the clip region when drawing, are tested.
+
+  The index is rebuilt when needed after children are added, removed, or
+  resized with Fl_Widget::resize(). It is disabled by default.
+*/
+void Fl_Group::spatial_index(int on) {
+  if (on && !index_) {
+    index_ = new Fl_Group_Index;
+  } else if (!on && index_) {
+    delete index_;
+    index_ = 0;
+  }
+}
+
+// Finds the children that may contain the point X,Y. Returns the number
+// of children and their indexes in increasing order in 'list', or
+// children() and NULL in 'list' if the group has no spatial index.
+int Fl_Group::children_at(int X, int Y, const int *&list) {
+  list = 0;
+  if (!index_ || children_ < 2) return children_;
+  Fl_Group_Index *g = index_;
+  if (!g->valid) g->build(array(), children_);
+  list = g->found; // (empty list)
+  if (!g->cols || X < g->X || Y < g->Y || X >= g->X + g->W || Y >= g->Y + g->H)
+    return 0;
+  int c = ((Y - g->Y) / g->ch) * g->cols + (X - g->X) / g->cw;
+  list = g->items + g->start[c];
+  return g->start[c+1] - g->start[c];
+}
+
+static int compare_ints(const void *a, const void *b) {
+  return *(const int*)a - *(const int*)b;
+}
+
+// Finds the children that may have to be drawn in the current clip region:
+// those overlapping its bounding box, and those in the 'outside' list.
+// Returns the number of children and their indexes in increasing order in
+// 'list', or children() and NULL in 'list' if all children must be drawn.
+int Fl_Group::children_in_clip(const int *&list) {
+  list = 0;
+  if (!index_ || children_ < 2) return children_;
+  Fl_Group_Index *g = index_;
+  if (!g->valid) g->build(array(), children_);
+  int X, Y, W, H;
+  if (!g->cols || !fl_clip_box(g->X, g->Y, g->W, g->H, X, Y, W, H))
+    return children_; // all children are inside the clip region
+  if (++g->gen == 0) { // stamps wrapped around
+    memset(g->stamp, 0, g->alloc * sizeof(int));
+    g->gen = 1;
+  }
+  int i, k, n = 0;
+  if (W > 0 && H > 0) {
+    int c0 = (X - g->X) / g->cw, c1 = (X + W - 1 - g->X) / g->cw;
+    int r0 = (Y - g->Y) / g->ch, r1 = (Y + H - 1 - g->Y) / g->ch;
+    for (int r = r0; r <= r1; r++)
+      for (int c = c0; c <= c1; c++) {
+        int cell = r * g->cols + c;
+        for (k = g->start[cell]; k < g->start[cell+1]; k++) {
+          i = g->items[k];
+          if (g->stamp[i] != g->gen) { g->stamp[i] = g->gen; g->found[n++] = i; }
+        }
+      }
+  }
+  for (k = 0; k < g->noutside; k++) {
+    i = g->outside[k];
+    if (g->stamp[i] != g->gen) { g->stamp[i] = g->gen; g->found[n++] = i; }
+  }
+  qsort(g->found, n, sizeof(int), compare_ints);
+  list = g->found;
+  return n;
+}
+
 int Fl_Group::handle(int event) {
 
   Fl_Widget*const* a = array();
-  int i;
+  int i, n;
+  const int *list; // children at the mouse, see children_at()
   Fl_Widget* o;
 
   switch (event) {
@@ -172,8 +369,9 @@ int Fl_Group::handle(int event) {
     return navigation(navkey());
 
   case FL_SHORTCUT:
-    for (i = children(); i--;) {
-      o = a[i];
+    n = children_at(Fl::event_x(), Fl::event_y(), list);
+    for (i = n; i--;) {
+      o = a[list ? list[i] : i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_SHORTCUT))
         return 1;
     }
@@ -187,8 +385,9 @@ int Fl_Group::handle(int event) {
 
   case FL_ENTER:
   case FL_MOVE:
-    for (i = children(); i--;) {
-      o = a[i];
+    n = children_at(Fl::event_x(), Fl::event_y(), list);
+    for (i = n; i--;) {
+      o = a[list ? list[i] : i];
       if (o->visible() && Fl::event_inside(o)) {
         if (o->contains(Fl::belowmouse())) {
           return send(o,FL_MOVE);
@@ -203,8 +402,9 @@ int Fl_Group::handle(int event) {
 
   case FL_DND_ENTER:
   case FL_DND_DRAG:
-    for (i = children(); i--;) {
-      o = a[i];
+    n = children_at(Fl::event_x(), Fl::event_y(), list);
+    for (i = n; i--;) {
+      o = a[list ? list[i] : i];
       if (o->takesevents() && Fl::event_inside(o)) {
         if (o->contains(Fl::belowmouse())) {
           return send(o,FL_DND_DRAG);
@@ -218,8 +418,9 @@ int Fl_Group::handle(int event) {
     return 0;
 
   case FL_PUSH:
-    for (i = children(); i--;) {
-      o = a[i];
+    n = children_at(Fl::event_x(), Fl::event_y(), list);
+    for (i = n; i--;) {
+      o = a[list ? list[i] : i];
       if (o->takesevents() && Fl::event_inside(o)) {
         Fl_Widget_Tracker wp(o);
         if (send(o,FL_PUSH)) {
@@ -236,8 +437,9 @@ int Fl_Group::handle(int event) {
     if (o == this) return 0;
     else if (o) send(o,event);
     else {
-      for (i = children(); i--;) {
-        o = a[i];
+      n = children_at(Fl::event_x(), Fl::event_y(), list);
+      for (i = n; i--;) {
+        o = a[list ? list[i] : i];
         if (o->takesevents() && Fl::event_inside(o)) {
           if (send(o,event)) return 1;
         }
@@ -246,8 +448,9 @@ int Fl_Group::handle(int event) {
     return 0;
 
   case FL_MOUSEWHEEL:
-    for (i = children(); i--;) {
-      o = a[i];
+    n = children_at(Fl::event_x(), Fl::event_y(), list);
+    for (i = n; i--;) {
+      o = a[list ? list[i] : i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_MOUSEWHEEL))
         return 1;
     }
@@ -366,6 +569,7 @@ Fl_Group::Fl_Group(int X,int Y,int W,int H,const char *l)
   resizable_ = this;
   bounds_ = 0; // this is allocated when first resize() is done
   sizes_ = 0; // see bounds_ (FLTK 1.3 compatibility)
+  index_ = 0;
 
   // Subclasses may want to construct child objects as part of their
   // constructor, so make sure they are add()'d to this object.
@@ -453,6 +657,7 @@ Fl_Group::~Fl_Group() {
   if (current_ == this)
     end();
   clear();
+  delete index_;
 }
 
 /**
@@ -611,6 +816,7 @@ int Fl_Group::delete_child(int index) {
   \see sizes() (deprecated)
 */
 void Fl_Group::init_sizes() {
+  invalidate_index();
   delete[] bounds_;
   bounds_ = 0;
   delete[] sizes_;      // FLTK 1.3 compatibility
@@ -847,14 +1053,18 @@ void Fl_Group::draw_children() {
                  h() - Fl::box_dh(box()));
   }
 
+  // with a spatial index, skip the children outside the clip region
+  const int *list;
+  int n = children_in_clip(list);
+
   if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
-    for (int i=children_; i--;) {
-      Fl_Widget& o = **a++;
+    for (int i=0; i<n; i++) {
+      Fl_Widget& o = *a[list ? list[i] : i];
       draw_child(o);
       draw_outside_label(o);
     }
   } else {      // only redraw the children that need it:
-    for (int i=children_; i--;) update_child(**a++);
+    for (int i=0; i<n; i++) update_child(*a[list ? list[i] : i]);
   }
 
   if (clip_children()) fl_pop_clip();
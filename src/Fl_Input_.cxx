@@ -199,6 +199,88 @@ void Fl_Input_::setfont() const {
   fl_font(textfont(), textsize());
 }
 
+/** \internal
+  Lays out display lines until line \p n and the line containing
+  index \p i are known.
+
+  The start and end of every display line, as returned by expand(),
+  are cached in \p lines_, so that drawing and mouse handling do not
+  have to lay out all text from the start for every event. Editing
+  the text discards the lines after the change, see invalidate_lines().
+
+  \param [in] n index of a display line
+  \param [in] i index into the text
+*/
+void Fl_Input_::layout_lines(int n, int i) const {
+  int width = wrap() ? w() - Fl::box_dw(box()) - 2 : 0;
+  if (width != lines_width_ || input_type() != lines_type_ ||
+      textfont() != lines_font_ || textsize() != lines_size_) {
+    lines_width_ = width;
+    lines_type_ = input_type();
+    lines_font_ = textfont();
+    lines_size_ = textsize();
+    nlines_ = 0;
+    lines_done_ = 0;
+  }
+  if (lines_done_) return;
+  if (nlines_ > n && lines_[2*nlines_-1] >= i) return;
+
+  setfont();
+  char buf[MAXBUF];
+  const char *p = value();
+  if (nlines_) {
+    p = value() + lines_[2*nlines_-1];
+    if (*p == '\n' || *p == ' ') p++;
+  }
+  for (;;) {
+    const char *e = expand(p, buf);
+    if (nlines_ >= alloc_lines_) {
+      alloc_lines_ = alloc_lines_ ? 2*alloc_lines_ : 64;
+      lines_ = (int*)realloc(lines_, 2*alloc_lines_*sizeof(int));
+    }
+    lines_[2*nlines_] = (int) (p-value());
+    lines_[2*nlines_+1] = (int) (e-value());
+    nlines_++;
+    if (e >= value_+size_) { lines_done_ = 1; break; }
+    if (nlines_ > n && e-value() >= i) break;
+    if (*e == '\n' || *e == ' ') e++;
+    p = e;
+  }
+}
+
+/** \internal
+  Returns the index of the display line containing index \p i.
+
+  If \p i is at the end of a line and at the start of the next line, the
+  first of both lines is returned.
+*/
+int Fl_Input_::line_index(int i) const {
+  layout_lines(0, i);
+  int a = 0, b = nlines_-1;
+  while (a < b) {  // find the last line starting before or at i
+    int m = (a+b+1)/2;
+    if (lines_[2*m] <= i) a = m; else b = m-1;
+  }
+  if (a > 0 && i <= lines_[2*a-1]) a--;
+  return a;
+}
+
+/** \internal
+  Discards the layout of all display lines that may change when the text
+  at index \p i is modified.
+*/
+void Fl_Input_::invalidate_lines(int i) {
+  int a = 0, b = nlines_;
+  while (a < b) {  // find the number of lines ending before i
+    int m = (a+b)/2;
+    if (lines_[2*m+1] < i) a = m+1; else b = m;
+  }
+  // a word wrapped to the next line may fit into the previous line now
+  if (wrap() && a > 0) a--;
+  nlines_ = a;
+  lines_done_ = 0;
+}
+
 /**
   Draws the text in the passed bounding box.
 
@@ -232,38 +314,33 @@ void Fl_Input_::drawtext(int X, int Y, int W, int H) {
   const char *p, *e;
   char buf[MAXBUF];
 
-  // count how many lines and put the last one into the buffer:
-  // And figure out where the cursor is:
+  // figure out where the cursor is, using the cached line layout:
   int height = fl_height();
   int threshold = height/2;
-  int lines;
   int curx, cury;
-  for (p=value(), curx=cury=lines=0; ;) {
+  {
+    int line = line_index(position());
+    p = value() + lines_[2*line];
     e = expand(p, buf);
-    if (position() >= p-value() && position() <= e-value()) {
-      curx = int(expandpos(p, value()+position(), buf, 0)+.5);
-      if (Fl::focus()==this && !was_up_down) up_down_pos = curx;
-      cury = lines*height;
-      int newscroll = xscroll_;
-      if (curx > newscroll+W-threshold) {
-        // figure out scrolling so there is space after the cursor:
-        newscroll = curx+threshold-W;
-        // figure out the furthest left we ever want to scroll:
-        int ex = int(expandpos(p, e, buf, 0))+4-W;
-        // use minimum of both amounts:
-        if (ex < newscroll) newscroll = ex;
-      } else if (curx < newscroll+threshold) {
-        newscroll = curx-threshold;
-      }
-      if (newscroll < 0) newscroll = 0;
-      if (newscroll != xscroll_) {
-        xscroll_ = newscroll;
-        mu_p = 0; erase_cursor_only = 0;
-      }
+    curx = int(expandpos(p, value()+position(), buf, 0)+.5);
+    if (Fl::focus()==this && !was_up_down) up_down_pos = curx;
+    cury = line*height;
+    int newscroll = xscroll_;
+    if (curx > newscroll+W-threshold) {
+      // figure out scrolling so there is space after the cursor:
+      newscroll = curx+threshold-W;
+      // figure out the furthest left we ever want to scroll:
+      int ex = int(expandpos(p, e, buf, 0))+4-W;
+      // use minimum of both amounts:
+      if (ex < newscroll) newscroll = ex;
+    } else if (curx < newscroll+threshold) {
+      newscroll = curx-threshold;
+    }
+    if (newscroll < 0) newscroll = 0;
+    if (newscroll != xscroll_) {
+      xscroll_ = newscroll;
+      mu_p = 0; erase_cursor_only = 0;
     }
-    lines++;
-    if (e >= value_+size_) break;
-    p = e+1;
   }
 
   // adjust the scrolling:
@@ -280,15 +357,18 @@ void Fl_Input_::drawtext(int X, int Y, int W, int H) {
   fl_push_clip(X, Y, W, H);
   Fl_Color tc = active_r() ? textcolor() : fl_inactive(textcolor());
 
-  p = value();
+  // start with the first visible line:
+  int line = yscroll_ > 0 ? yscroll_/height : 0;
+  layout_lines(line, 0);
+  if (line >= nlines_) line = nlines_-1;
+  p = value() + lines_[2*line];
   // visit each line and draw it:
   int desc = height-fl_descent();
   float xpos = (float)(X - xscroll_ + 1);
-  int ypos = -yscroll_;
+  int ypos = line*height - yscroll_;
   for (; ypos < H;) {
 
-    // re-expand line unless it is the last one calculated above:
-    if (lines>1) e = expand(p, buf);
+    e = expand(p, buf);
 
     if (ypos <= -height) goto CONTINUE; // clipped off top
 
@@ -464,6 +544,10 @@ int Fl_Input_::line_end(int i) const {
   if (input_type() != FL_MULTILINE_INPUT) return size();
 
   if (wrap()) {
+    // use the cached line layout if it is known up to i:
+    layout_lines(0, 0);
+    if (lines_done_ || lines_[2*nlines_-1] >= i)
+      return lines_[2*line_index(i)+1];
     // go to the start of the paragraph:
     int j = i;
     while (j > 0 && index(j-1) != '\n') j--;
@@ -493,6 +577,12 @@ int Fl_Input_::line_end(int i) const {
 */
 int Fl_Input_::line_start(int i) const {
   if (input_type() != FL_MULTILINE_INPUT) return 0;
+  if (wrap()) {
+    // use the cached line layout if it is known up to i:
+    layout_lines(0, 0);
+    if (lines_done_ || lines_[2*nlines_-1] >= i)
+      return lines_[2*line_index(i)];
+  }
   int j = i;
   while (j > 0 && index(j-1) != '\n') j--;
   if (wrap()) {
@@ -537,12 +627,11 @@ void Fl_Input_::handle_mouse(int X, int Y, int /*W*/, int /*H*/, int drag) {
     (Fl::event_y()-Y+yscroll_)/fl_height() : 0;
 
   int newpos = 0;
-  for (p=value();; ) {
-    e = expand(p, buf);
-    theline--; if (theline < 0) break;
-    if (e >= value_+size_) break;
-    p = e+1;
-  }
+  if (theline < 0) theline = 0;
+  layout_lines(theline, 0);
+  if (theline >= nlines_) theline = nlines_-1;
+  p = value() + lines_[2*theline];
+  e = expand(p, buf);
   const char *l, *r, *t; double f0 = Fl::event_x()-X+xscroll_;
   for (l = p, r = e; l<r; ) {
     double f;
@@ -834,6 +923,8 @@ int Fl_Input_::replace(int b, int e, const char* text, int ilen) {
 
   int nchars = 0;       // characters in value() - deleted + inserted
   const char *p = value_;
+  // no need to count characters if the number of bytes fits
+  if (size_-(e-b)+ilen <= maximum_size()) p = value_+size_;
   while (p < (char *)(value_+size_)) {
     if (p == (char *)(value_+b)) { // skip removed part
       p = (char *)(value_+e);
@@ -846,6 +937,7 @@ int Fl_Input_::replace(int b, int e, const char* text, int ilen) {
   }
   int nlen = 0;         // length (in bytes) to be inserted
   p = text;
+  if (size_-(e-b)+ilen <= maximum_size()) nlen = ilen, p = text+ilen;
   while (p < (char *)(text+ilen) && nchars < maximum_size()) {
     int ulen = fl_utf8len(*p);
     if (ulen < 1) ulen = 1; // invalid UTF-8 character: count as 1
@@ -856,6 +948,7 @@ int Fl_Input_::replace(int b, int e, const char* text, int ilen) {
   ilen = nlen;
 
   put_in_buffer(size_+ilen);
+  invalidate_lines(b);
 
   if (e>b) {
     if (undowidget == this && b == undoat) {
@@ -944,6 +1037,7 @@ int Fl_Input_::undo() {
   int b1 = b;
 
   put_in_buffer(size_+ilen);
+  invalidate_lines(b);
 
   if (ilen) {
     memmove(buffer+b+ilen, buffer+b, size_-b+1);
@@ -1147,6 +1241,12 @@ Fl_Input_::Fl_Input_(int X, int Y, int W, int H, const char* l)
   buffer  = 0;
   value_ = "";
   xscroll_ = yscroll_ = 0;
+  lines_ = 0;
+  nlines_ = alloc_lines_ = 0;
+  lines_done_ = 0;
+  lines_width_ = lines_type_ = -1;
+  lines_font_ = FL_HELVETICA;
+  lines_size_ = 0;
   maximum_size_ = 32767;
   shortcut_ = 0;
   set_flag(SHORTCUT_LABEL);
@@ -1221,6 +1321,7 @@ int Fl_Input_::static_value(const char* str, int len) {
     if (xscroll_ || yscroll_) {
       xscroll_ = yscroll_ = 0;
       minimal_update(0);
+      invalidate_lines(0);
     } else {
       int i = 0;
       // find first different character:
@@ -1229,11 +1330,13 @@ int Fl_Input_::static_value(const char* str, int len) {
         if (i==size_ && i==len) return 0;
       }
       minimal_update(i);
+      invalidate_lines(i);
     }
     value_ = str;
     size_ = len;
   } else { // empty new value:
     if (!size_) return 0; // both old and new are empty.
+    invalidate_lines(0);
     size_ = 0;
     value_ = "";
     xscroll_ = yscroll_ = 0;
@@ -1318,6 +1421,7 @@ void Fl_Input_::resize(int X, int Y, int W, int H) {
 Fl_Input_::~Fl_Input_() {
   if (undowidget == this) undowidget = 0;
   if (bufsize) free((void*)buffer);
+  if (lines_) free(lines_);
 }
 
 /** \internal
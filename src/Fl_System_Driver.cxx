@@ -494,6 +494,12 @@ void Fl_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = 0;
 }
 
+double Fl_System_Driver::monotonic_time() {
+  time_t sec; int usec;
+  gettime(&sec, &usec);
+  return double(sec) + usec / 1000000.0;
+}
+
 /**
  \}
  \endcond
@@ -46,6 +46,332 @@ void Fl_Table::IntVector::size(unsigned int count) {
   }
 }
 
+// Prefix sums of an IntVector (private to Fl_Table)
+//
+//    tree[k] holds the sum of the values k-(k&-k) to k-1,
+//    so a prefix sum is the sum of at most log2(n) nodes.
+
+Fl_Table::IntSums::~IntSums() { // DTOR
+  if (tree)
+    free(tree);
+  tree = 0;
+}
+
+// Build the tree from the values of 'v' in O(n)
+void Fl_Table::IntSums::build(IntVector &v) {
+  unsigned int n = v.size();
+  tree = (long*)realloc(tree, (n+1) * sizeof(long));
+  for ( unsigned int k=1; k<=n; k++ ) tree[k] = v[k-1];
+  for ( unsigned int k=1; k<=n; k++ ) {
+    unsigned int parent = k + (k & (0-k));
+    if ( parent <= n ) tree[parent] += tree[k];
+  }
+  _size = n;
+}
+
+// Add 'delta' to value 'x'
+void Fl_Table::IntSums::add(unsigned int x, long delta) {
+  for ( unsigned int k=x+1; k<=_size; k += (k & (0-k)) ) tree[k] += delta;
+}
+
+// Return the sum of the first 'count' values
+long Fl_Table::IntSums::sum(unsigned int count) {
+  if ( count > _size ) count = _size;
+  long s = 0;
+  for ( unsigned int k=count; k>0; k -= (k & (0-k)) ) s += tree[k];
+  return(s);
+}
+
+// Return the number of values whose sum is <= 'pos', i.e. the index
+// of the value covering 'pos', and the sum of the values before it in 'start'
+unsigned int Fl_Table::IntSums::find(long pos, long &start) {
+  unsigned int n = 0, bit = 1;
+  start = 0;
+  while ( 2*bit <= _size ) bit *= 2;
+  for ( ; _size && bit; bit /= 2 ) {
+    if ( n+bit <= _size && start+tree[n+bit] <= pos ) {
+      n += bit;
+      start += tree[n];
+    }
+  }
+  return(n);
+}
+
+// A cache of drawn cells (private to Fl_Table)
+//
+//    Entries in use are on a doubly linked list, most recently drawn
+//    first, so trim() removes the least recently drawn cells. Removed
+//    entries are kept on a free list linked by 'next'.
+
+static inline unsigned int cell_hash(int row, int col) {
+  return((unsigned int)row * 2654435761u ^ (unsigned int)col * 40503u);
+}
+
+Fl_Table::CellCache::CellCache() { // CTOR
+  arr        = 0;
+  _size      = 0;
+  _alloc     = 0;
+  hash       = 0;
+  hash_size  = 0;
+  count      = 0;
+  head       = -1;
+  tail       = -1;
+  free_list  = -1;
+  bytes      = 0;
+  generation = 0;
+}
+
+Fl_Table::CellCache::~CellCache() { // DTOR
+  clear();
+}
+
+// Return the hash table slot of row/col: its entry, or an empty slot
+int Fl_Table::CellCache::slot(int row, int col) const {
+  unsigned int mask = hash_size - 1;
+  unsigned int k = cell_hash(row, col) & mask;
+  while ( hash[k] != -1 && ( arr[hash[k]].row != row || arr[hash[k]].col != col ) )
+    k = (k + 1) & mask;
+  return(k);
+}
+
+// Rebuild the hash table with 'newsize' slots
+void Fl_Table::CellCache::rehash(int newsize) {
+  hash = (int*)realloc(hash, newsize * sizeof(int));
+  hash_size = newsize;
+  for ( int k=0; k<hash_size; k++ ) hash[k] = -1;
+  for ( int i=0; i<_size; i++ )
+    if ( arr[i].row != -1 ) hash[slot(arr[i].row, arr[i].col)] = i;
+}
+
+// Remove entry 'i' from the LRU list
+void Fl_Table::CellCache::unlink(int i) {
+  Entry &e = arr[i];
+  if ( e.prev != -1 ) arr[e.prev].next = e.next; else head = e.next;
+  if ( e.next != -1 ) arr[e.next].prev = e.prev; else tail = e.prev;
+}
+
+// Return the entry of row/col, or -1 if none
+int Fl_Table::CellCache::find(int row, int col) const {
+  if ( count == 0 ) return(-1);
+  return(hash[slot(row, col)]);
+}
+
+// Add an empty entry for row/col, which must not be in the cache yet
+int Fl_Table::CellCache::add(int row, int col) {
+  if ( 2 * (count + 1) > hash_size ) rehash(hash_size ? hash_size * 2 : 64);
+  int i;
+  if ( free_list != -1 ) {
+    i = free_list;
+    free_list = arr[i].next;
+  } else {
+    if ( _size == _alloc ) {
+      _alloc = _alloc ? _alloc * 2 : 64;
+      arr = (Entry*)realloc(arr, _alloc * sizeof(Entry));
+    }
+    i = _size++;
+  }
+  Entry &e = arr[i];
+  e.row        = row;
+  e.col        = col;
+  e.w          = 0;
+  e.h          = 0;
+  e.scale      = 0;
+  e.state      = 0;
+  e.generation = generation - 1;        // not drawn yet
+  e.offscreen  = 0;
+  e.bytes      = 0;
+  e.prev       = -1;
+  e.next       = head;
+  if ( head != -1 ) arr[head].prev = i; else tail = i;
+  head = i;
+  hash[slot(row, col)] = i;
+  count++;
+  return(i);
+}
+
+// Move entry 'i' to the front of the LRU list
+void Fl_Table::CellCache::touch(int i) {
+  if ( head == i ) return;
+  unlink(i);
+  arr[i].prev = -1;
+  arr[i].next = head;
+  arr[head].prev = i;
+  head = i;
+}
+
+// Remove entry 'i' and delete its offscreen
+void Fl_Table::CellCache::remove(int i) {
+  Entry &e = arr[i];
+  if ( e.offscreen ) fl_delete_offscreen(e.offscreen);
+  bytes -= e.bytes;
+  // Delete from the hash table by shifting back the entries after it
+  unsigned int mask = hash_size - 1;
+  unsigned int k = slot(e.row, e.col), j = k;
+  for (;;) {
+    j = (j + 1) & mask;
+    if ( hash[j] == -1 ) break;
+    unsigned int h = cell_hash(arr[hash[j]].row, arr[hash[j]].col) & mask;
+    if ( k <= j ? ( k < h && h <= j ) : ( k < h || h <= j ) ) continue;
+    hash[k] = hash[j];
+    k = j;
+  }
+  hash[k] = -1;
+  unlink(i);
+  e.row = e.col = -1;
+  e.next = free_list;
+  free_list = i;
+  count--;
+}
+
+// Remove the entries of cells outside 'rows' and 'cols'
+void Fl_Table::CellCache::remove_outside(int rows, int cols) {
+  for ( int i=0; i<_size && count>0; i++ )
+    if ( arr[i].row != -1 && ( arr[i].row >= rows || arr[i].col >= cols ) )
+      remove(i);
+}
+
+// Mark the entries of cells in rows r1..r2 and columns c1..c2 as not drawn
+void Fl_Table::CellCache::invalidate(int r1, int r2, int c1, int c2) {
+  if ( r1 == r2 && c1 == c2 ) {
+    int i = find(r1, c1);
+    if ( i != -1 ) arr[i].generation = generation - 1;
+    return;
+  }
+  for ( int i=0; i<_size; i++ )
+    if ( arr[i].row >= r1 && arr[i].row <= r2 && arr[i].col >= c1 && arr[i].col <= c2 )
+      arr[i].generation = generation - 1;
+}
+
+// Remove least recently drawn entries until the offscreens use at most 'maxbytes'
+void Fl_Table::CellCache::trim(long maxbytes) {
+  while ( bytes > maxbytes && tail != -1 ) remove(tail);
+}
+
+// Remove all entries
+void Fl_Table::CellCache::clear() {
+  for ( int i=0; i<_size; i++ )
+    if ( arr[i].row != -1 && arr[i].offscreen ) fl_delete_offscreen(arr[i].offscreen);
+  if ( arr ) free(arr);
+  if ( hash ) free(hash);
+  arr = 0;
+  hash = 0;
+  _size = _alloc = hash_size = count = 0;
+  head = tail = free_list = -1;
+  bytes = 0;
+}
+
+
+// A set of rows (used by Fl_Table and Fl_Table_Row)
+//
+//    The set is stored as the sorted boundaries of its ranges:
+//    arr[0] is the first row of the first range, arr[1] the row after
+//    its last row, and so on. Boundaries are strictly increasing, so
+//    ranges never touch, and a row is in the set if an odd number of
+//    boundaries are <= row.
+//
+
+Fl_Table::RowSet::~RowSet() {               // DTOR
+  if (arr) free(arr);
+  arr = 0;
+}
+
+// Return the number of boundaries <= val
+int Fl_Table::RowSet::find(int val) const {
+  int lo = 0, hi = _size;
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( arr[mid] <= val ) lo = mid + 1;
+    else                   hi = mid;
+  }
+  return(lo);
+}
+
+// Replace 'n' boundaries at index 'i' with 'count' new ones
+void Fl_Table::RowSet::replace(int i, int n, const int *vals, int count) {
+  int newsize = _size - n + count;
+  if ( newsize > _alloc ) {
+    _alloc = _alloc ? _alloc * 2 : 16;
+    if ( _alloc < newsize ) _alloc = newsize;
+    arr = (int*)realloc(arr, (unsigned)_alloc * sizeof(int));
+  }
+  if ( count != n )
+    memmove(arr + i + count, arr + i + n, (_size - i - n) * sizeof(int));
+  if ( count )
+    memcpy(arr + i, vals, count * sizeof(int));
+  _size = newsize;
+}
+
+// Is row in the set?
+int Fl_Table::RowSet::contains(int row) const {
+  return(find(row) & 1);
+}
+
+// Change rows [start,end): val 0=remove, 1=add, 2=toggle.
+//    Returns 1 if the set changed, 0 if not.
+//
+int Fl_Table::RowSet::set(int start, int end, int val) {
+  if ( start >= end ) return(0);
+  if ( val == 2 ) {
+    // Toggling a range flips its two boundaries in and out of the set
+    int b[2] = { end, start };
+    for ( int t=0; t<2; t++ ) {
+      int i = find(b[t] - 1);
+      if ( i < _size && arr[i] == b[t] ) replace(i, 1, 0, 0);
+      else                               replace(i, 0, b + t, 1);
+    }
+    return(1);
+  }
+  // Boundaries in [start,end] are replaced by at most two new ones:
+  // 'start' if it is not already inside (or at the end of) a range of
+  // the new state, and 'end' likewise.
+  //
+  int p = find(start - 1);                      // boundaries < start
+  int q = find(end);                            // boundaries <= end
+  int vals[2], count = 0;
+  if ( val ) {
+    if ( !(p & 1) ) vals[count++] = start;
+    if ( !(q & 1) ) vals[count++] = end;
+  } else {
+    if ( p & 1 ) vals[count++] = start;
+    if ( q & 1 ) vals[count++] = end;
+  }
+  if ( q - p == count && memcmp(arr + p, vals, count * sizeof(int)) == 0 )
+    return(0);                                  // no change
+  replace(p, q - p, vals, count);
+  return(1);
+}
+
+// Return first row in the set that is > row, or -1 if none
+int Fl_Table::RowSet::next(int row) const {
+  int i = find(row + 1);
+  if ( i & 1 ) return(row + 1);
+  return(i < _size ? arr[i] : -1);
+}
+
+// Return the end of the range that contains row, or row if not in the set
+int Fl_Table::RowSet::end_of(int row) const {
+  int i = find(row);
+  return(( i & 1 ) ? arr[i] : row);
+}
+
+// Return the number of rows in the set
+int Fl_Table::RowSet::count() const {
+  int n = 0;
+  for ( int i=0; i<_size; i+=2 ) n += arr[i+1] - arr[i];
+  return(n);
+}
+
+// Remove all rows >= count
+void Fl_Table::RowSet::truncate(int count) {
+  int i = find(count - 1);
+  if ( i & 1 ) arr[i++] = count;
+  _size = i;
+  if ( _size == 0 && arr ) {
+    free(arr);
+    init();
+  }
+}
+
 
 /** Sets the vertical scroll position so 'row' is at the top,
     and causes the screen to redraw.
@@ -61,7 +387,7 @@ void Fl_Table::row_position(int row) {
   }
   vscrollbar->Fl_Slider::value(newtop);
   table_scrolled();
-  redraw();
+  _redraw_scrolled();
   _row_position = row;  // HACK: override what table_scrolled() came up with
 }
 
@@ -80,7 +406,7 @@ void Fl_Table::col_position(int col) {
   }
   hscrollbar->Fl_Slider::value(newleft);
   table_scrolled();
-  redraw();
+  _redraw_scrolled();
   _col_position = col;  // HACK: override what table_scrolled() came up with
 }
 
@@ -88,38 +414,24 @@ void Fl_Table::col_position(int col) {
   Returns the scroll position (in pixels) of the specified 'row'.
 */
 long Fl_Table::row_scroll_position(int row) {
-  int startrow = 0;
-  long scroll = 0;
+  if ( row <= 0 ) return(0);
   // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
+  //     Use the prefix sums of the row heights, rebuild them if needed
   //
-  if ( toprow_scrollpos != -1 && row >= toprow ) {
-    scroll = toprow_scrollpos;
-    startrow = toprow;
-  }
-  for ( int t=startrow; t<row; t++ ) {
-    scroll += row_height(t);
-  }
-  return(scroll);
+  if ( !_rowsums.size() ) _rowsums.build(_rowheights);
+  return(_rowsums.sum(row));
 }
 
 /**
   Returns the scroll position (in pixels) of the specified column 'col'.
 */
 long Fl_Table::col_scroll_position(int col) {
-  int startcol = 0;
-  long scroll = 0;
+  if ( col <= 0 ) return(0);
   // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
+  //     Use the prefix sums of the column widths, rebuild them if needed
   //
-  if ( leftcol_scrollpos != -1 && col >= leftcol ) {
-    scroll = leftcol_scrollpos;
-    startcol = leftcol;
-  }
-  for ( int t=startcol; t<col; t++ ) {
-    scroll += col_width(t);
-  }
-  return(scroll);
+  if ( !_colsums.size() ) _colsums.build(_colwidths);
+  return(_colsums.sum(col));
 }
 
 /**
@@ -144,6 +456,11 @@ Fl_Table::Fl_Table(int X, int Y, int W, int H, const char *l) : Fl_Group(X,Y,W,H
   _redraw_botrow    = -1;
   _redraw_leftcol   = -1;
   _redraw_rightcol  = -1;
+  _drawn_hpos       = 0;
+  _drawn_vpos       = 0;
+  _cellcache_max    = 0;
+  _async_rows       = 0;
+  _async_lasttop    = 0;
   table_w           = 0;
   table_h           = 0;
   toprow            = 0;
@@ -214,9 +531,12 @@ void Fl_Table::row_height(int row, int height) {
   // Add row heights, even if none yet
   int now_size = (int)_rowheights.size();
   if ( row >= now_size ) {
-    _rowheights.size(row);
+    _rowheights.size(row+1);
     while (now_size < row)
       _rowheights[now_size++] = height;
+    _rowsums.clear();
+  } else {
+    _rowsums.add(row, height - _rowheights[row]);
   }
   _rowheights[row] = height;
   table_resized();
@@ -247,6 +567,9 @@ void Fl_Table::col_width(int col, int width)
     while (now_size < col) {
       _colwidths[now_size++] = width;
     }
+    _colsums.clear();
+  } else {
+    _colsums.add(col, width - _colwidths[col]);
   }
   _colwidths[col] = width;
   table_resized();
@@ -560,38 +883,38 @@ void Fl_Table::recalc_dimensions() {
   TODO: Assumes ti[xywh] has already been recalculated.
 */
 void Fl_Table::table_scrolled() {
+  // Make sure the prefix sums of row heights and column widths are valid
+  if ( !_rowsums.size() ) _rowsums.build(_rowheights);
+  if ( !_colsums.size() ) _colsums.build(_colwidths);
   // Find top row
-  int y, row, voff = vscrollbar->value();
-  for ( row=y=0; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y > voff ) { y -= row_height(row); break; }
-  }
+  long y;
+  int row, voff = vscrollbar->value();
+  row = (int)_rowsums.find(voff, y);
+  if ( row >= _rows ) { row = _rows; y = row_scroll_position(_rows); }
   _row_position = toprow = ( row >= _rows ) ? (row - 1) : row;
-  toprow_scrollpos = y;         // OPTIMIZATION: save for later use
+  toprow_scrollpos = (int)y;    // OPTIMIZATION: save for later use
   // Find bottom row
+  //    First row ending at or below the bottom edge
+  //
+  long dummy;
   voff = vscrollbar->value() + tih;
-  for ( ; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y >= voff ) { break; }
-  }
-  botrow = ( row >= _rows ) ? (row - 1) : row;
+  int brow = (int)_rowsums.find(voff - 1, dummy);
+  if ( brow > row ) row = brow;
+  botrow = ( row >= _rows ) ? (_rows - 1) : row;
   // Left column
-  int x, col, hoff = hscrollbar->value();
-  for ( col=x=0; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x > hoff ) { x -= col_width(col); break; }
-  }
+  long x;
+  int col, hoff = hscrollbar->value();
+  col = (int)_colsums.find(hoff, x);
+  if ( col >= _cols ) { col = _cols; x = col_scroll_position(_cols); }
   _col_position = leftcol = ( col >= _cols ) ? (col - 1) : col;
-  leftcol_scrollpos = x;        // OPTIMIZATION: save for later use
+  leftcol_scrollpos = (int)x;   // OPTIMIZATION: save for later use
   // Right column
-  //    Work with data left over from leftcol calculation
+  //    First column ending at or right of the right edge
   //
   hoff = hscrollbar->value() + tiw;
-  for ( ; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x >= hoff ) { break; }
-  }
-  rightcol = ( col >= _cols ) ? (col - 1) : col;
+  int rcol = (int)_colsums.find(hoff - 1, dummy);
+  if ( rcol > col ) col = rcol;
+  rightcol = ( col >= _cols ) ? (_cols - 1) : col;
   // First tell children to scroll
   draw_cell(CONTEXT_RC_RESIZE, 0,0,0,0,0,0);
 }
@@ -647,7 +970,74 @@ void Fl_Table::scroll_cb(Fl_Widget*w, void *data) {
   Fl_Table *o = (Fl_Table*)data;
   o->recalc_dimensions();       // recalc tix, tiy, etc.
   o->table_scrolled();
-  o->redraw();
+  o->_redraw_scrolled();
+}
+
+/**
+  Schedules a redraw after the table was scrolled.
+  Unless the table has child widgets (which table_scrolled() may have moved),
+  draw() moves the visible cells and headers with fl_scroll() and only
+  draws the newly exposed ones, instead of redrawing all cells.
+*/
+void Fl_Table::_redraw_scrolled() {
+  if ( table->visible() ) redraw();
+  else damage(FL_DAMAGE_SCROLL);
+}
+
+// fl_scroll() callback: draw newly exposed area of table
+void Fl_Table::_draw_area_cb(void *d, int X, int Y, int W, int H) {
+  ((Fl_Table*)d)->_draw_area(X, Y, W, H);
+}
+
+/**
+  Draws the headers and cells that are inside the area X/Y/W/H.
+  Used by draw() to draw the area exposed by scrolling.
+*/
+void Fl_Table::_draw_area(int X, int Y, int W, int H) {
+  // Find visible rows and columns that intersect the area
+  long dummy;
+  int voff = vscrollbar->value(), hoff = hscrollbar->value();
+  int r1 = toprow, r2 = (int)_rowsums.find(voff + (Y + H - 1 - tiy), dummy);
+  int c1 = leftcol, c2 = (int)_colsums.find(hoff + (X + W - 1 - tix), dummy);
+  if ( Y > tiy ) { int r = (int)_rowsums.find(voff + (Y - tiy), dummy); if ( r > r1 ) r1 = r; }
+  if ( X > tix ) { int c = (int)_colsums.find(hoff + (X - tix), dummy); if ( c > c1 ) c1 = c; }
+  if ( r2 > botrow ) r2 = botrow;
+  if ( c2 > rightcol ) c2 = rightcol;
+  int CX, CY, CW, CH;
+  fl_push_clip(X, Y, W, H);
+  // Row headers
+  if ( row_header() ) {
+    get_bounds(CONTEXT_ROW_HEADER, CX, CY, CW, CH);
+    if ( X < CX+CW && X+W > CX && Y < CY+CH && Y+H > CY ) {
+      fl_push_clip(CX, CY, CW, CH);
+      for ( int r = r1; r <= r2; r++ ) {
+        _redraw_cell(CONTEXT_ROW_HEADER, r, 0);
+      }
+      fl_pop_clip();
+    }
+  }
+  // Column headers
+  if ( col_header() ) {
+    get_bounds(CONTEXT_COL_HEADER, CX, CY, CW, CH);
+    if ( X < CX+CW && X+W > CX && Y < CY+CH && Y+H > CY ) {
+      fl_push_clip(CX, CY, CW, CH);
+      for ( int c = c1; c <= c2; c++ ) {
+        _redraw_cell(CONTEXT_COL_HEADER, 0, c);
+      }
+      fl_pop_clip();
+    }
+  }
+  // Cells
+  if ( X < tix+tiw && X+W > tix && Y < tiy+tih && Y+H > tiy ) {
+    fl_push_clip(tix, tiy, tiw, tih);
+    for ( int r = r1; r <= r2; r++ ) {
+      for ( int c = c1; c <= c2; c++ ) {
+        _redraw_cell(CONTEXT_CELL, r, c);
+      }
+    }
+    fl_pop_clip();
+  }
+  fl_pop_clip();
 }
 
 /**
@@ -663,6 +1053,12 @@ void Fl_Table::rows(int val) {
     while ( now_size < val ) {
       _rowheights[now_size++] = default_h;      // fill new
     }
+    _rowsums.clear();
+  }
+  if ( val < oldrows ) {
+    _cellcache.remove_outside(val, _cols);
+    _rows_loaded.truncate(val);
+    _rows_requested.truncate(val);
   }
   table_resized();
 
@@ -678,6 +1074,7 @@ void Fl_Table::rows(int val) {
   Set the number of columns in the table and redraw.
 */
 void Fl_Table::cols(int val) {
+  if ( val < _cols ) _cellcache.remove_outside(_rows, val);
   _cols = val;
   {
     int default_w = ( _colwidths.size() > 0 ) ? _colwidths[_colwidths.size()-1] : 80;
@@ -686,6 +1083,7 @@ void Fl_Table::cols(int val) {
     while ( now_size < val ) {
       _colwidths[now_size++] = default_w;       // fill new
     }
+    _colsums.clear();
   }
   table_resized();
   redraw();
@@ -1168,9 +1566,271 @@ void Fl_Table::_redraw_cell(TableContext context, int r, int c) {
   if ( r < 0 || c < 0 ) return;
   int X,Y,W,H;
   find_cell(context, r, c, X, Y, W, H); // find positions of cell
+  if ( context == CONTEXT_CELL && _async_rows && !_rows_loaded.contains(r) ) {
+    draw_placeholder(r, c, X, Y, W, H);  // data not loaded yet
+    return;
+  }
+  if ( context == CONTEXT_CELL && _cellcache_max && W > 0 && H > 0 &&
+       Fl_Surface_Device::surface() == Fl_Display_Device::display_device() ) {
+    _draw_cached_cell(r, c, X, Y, W, H);
+    return;
+  }
   draw_cell(context, r, c, X, Y, W, H); // call users' function to draw it
 }
 
+// Draw cell from the cell cache, drawing it into the cache first if needed
+void Fl_Table::_draw_cached_cell(int R, int C, int X, int Y, int W, int H) {
+  float s = Fl_Surface_Device::surface()->driver()->scale();
+  int state = cell_state(R, C);
+  int i = _cellcache.find(R, C);
+  if ( i == -1 ) i = _cellcache.add(R, C);
+  CellCache::Entry &e = _cellcache[i];
+  if ( e.offscreen && ( e.w != W || e.h != H || e.scale != s ) ) {
+    fl_delete_offscreen(e.offscreen);           // cell was resized
+    e.offscreen = 0;
+    _cellcache.bytes -= e.bytes;
+    e.bytes = 0;
+  }
+  if ( !e.offscreen ) {
+    e.offscreen = fl_create_offscreen(W, H);
+    if ( !e.offscreen ) {                       // out of resources? draw directly
+      draw_cell(CONTEXT_CELL, R, C, X, Y, W, H);
+      return;
+    }
+    e.w = W;
+    e.h = H;
+    e.scale = s;
+    e.bytes = long(W * s + 1) * long(H * s + 1) * 4;
+    e.generation = _cellcache.generation - 1;   // not drawn yet
+    _cellcache.bytes += e.bytes;
+  }
+  if ( e.generation != _cellcache.generation || e.state != state ) {
+    fl_begin_offscreen(e.offscreen);
+    draw_cell(CONTEXT_CELL, R, C, 0, 0, W, H);
+    fl_end_offscreen();
+    e.generation = _cellcache.generation;
+    e.state = state;
+  }
+  fl_copy_offscreen(X, Y, W, H, e.offscreen, 0, 0);
+  _cellcache.touch(i);
+  _cellcache.trim(_cellcache_max);
+}
+
+/**
+  Sets the size of the cell cache in kilobytes, 0 to disable it (the default).
+
+  With the cell cache enabled, each cell drawn by draw_cell() with
+  CONTEXT_CELL is drawn into an offscreen buffer, and later redraws of
+  the cell only copy the buffer to the screen, as long as the cell's
+  size and cell_state() did not change and the cell was not invalidated.
+  When the cache is full, the least recently drawn cells are removed.
+
+  This helps tables whose draw_cell() is expensive, e.g. cells showing
+  charts or formatted data. Call invalidate_cell(), invalidate_row(),
+  invalidate_col() or invalidate_cells() when the data of cells changes.
+  A cached cell uses about 4 bytes per pixel.
+
+  \note draw_cell() is called with X=0 and Y=0 when drawing a cell into
+  the cache, so it must draw relative to X and Y. The cache is not used
+  when the table is printed or drawn to an image.
+*/
+void Fl_Table::cell_cache_size(int kbytes) {
+  _cellcache_max = ( kbytes > 0 ) ? long(kbytes) * 1024 : 0;
+  if ( _cellcache_max ) _cellcache.trim(_cellcache_max);
+  else _cellcache.clear();
+}
+
+/**
+  Tells the cell cache that the cell at row \p R, column \p C must be
+  drawn again by draw_cell(), and redraws the cell if it is visible.
+  \see cell_cache_size(int)
+*/
+void Fl_Table::invalidate_cell(int R, int C) {
+  if ( R < 0 || C < 0 ) return;
+  _cellcache.invalidate(R, R, C, C);
+  if ( R >= toprow && R <= botrow && C >= leftcol && C <= rightcol )
+    redraw_range(R, R, C, C);
+}
+
+/**
+  Tells the cell cache that the cells of row \p R must be drawn again
+  by draw_cell(), and redraws the row if it is visible.
+  \see cell_cache_size(int)
+*/
+void Fl_Table::invalidate_row(int R) {
+  if ( R < 0 ) return;
+  _cellcache.invalidate(R, R, 0, _cols);
+  if ( R >= toprow && R <= botrow )
+    redraw_range(R, R, leftcol, rightcol);
+}
+
+/**
+  Tells the cell cache that the cells of column \p C must be drawn again
+  by draw_cell(), and redraws the column if it is visible.
+  \see cell_cache_size(int)
+*/
+void Fl_Table::invalidate_col(int C) {
+  if ( C < 0 ) return;
+  _cellcache.invalidate(0, _rows, C, C);
+  if ( C >= leftcol && C <= rightcol )
+    redraw_range(toprow, botrow, C, C);
+}
+
+/**
+  Tells the cell cache that all cells must be drawn again by draw_cell(),
+  and redraws the table.
+  \see cell_cache_size(int)
+*/
+void Fl_Table::invalidate_cells() {
+  _cellcache.generation++;
+  redraw();
+}
+
+/**
+  Enables or disables asynchronous row loading.
+
+  Use this for tables backed by slow data sources, where draw_cell()
+  should not wait for the data. With \p val non-zero, all rows start out
+  not loaded. When drawing, the table calls request_rows() for the
+  visible rows that are not loaded yet, and for rows above and below
+  them, more in the direction the table is being scrolled. Cells of
+  rows that are not loaded are drawn with draw_placeholder() instead
+  of draw_cell().
+
+  The application loads the rows, typically in a worker thread, and
+  calls rows_loaded() in the main thread when their data arrived, which
+  redraws the rows that are visible:
+
+  \code
+  struct Loaded { MyTable *table; int r1, r2; };
+  void loaded_cb(void *data) {                  // runs in the main thread
+    Loaded *l = (Loaded*)data;
+    l->table->rows_loaded(l->r1, l->r2);
+    delete l;
+  }
+  void MyTable::request_rows(int R1, int R2) {
+    queue_to_worker(R1, R2);                    // returns immediately
+  }
+  // ..in the worker thread, when rows R1..R2 have been fetched:
+  Loaded *l = new Loaded;
+  l->table = table; l->r1 = R1; l->r2 = R2;
+  Fl::awake(loaded_cb, l);
+  \endcode
+
+  Disabling and enabling async_rows() marks all rows as not loaded.
+  \see request_rows(), rows_loaded(), rows_unloaded(), row_loaded()
+*/
+void Fl_Table::async_rows(int val) {
+  _async_rows = val ? 1 : 0;
+  _async_lasttop = toprow;
+  _rows_loaded.truncate(0);
+  _rows_requested.truncate(0);
+  redraw();
+}
+
+/**
+  Tells the table that the data of rows \p R1 to \p R2 (inclusive) has
+  arrived, and redraws the rows that are visible.
+  Must be called in the main thread, see async_rows(int).
+*/
+void Fl_Table::rows_loaded(int R1, int R2) {
+  if ( R1 > R2 ) { int t = R1; R1 = R2; R2 = t; }
+  if ( R1 < 0 ) R1 = 0;
+  if ( R2 >= rows() ) R2 = rows() - 1;
+  if ( R1 > R2 ) return;
+  _rows_requested.set(R1, R2+1, 0);
+  if ( !_rows_loaded.set(R1, R2+1, 1) ) return;         // already loaded
+  _cellcache.invalidate(R1, R2, 0, _cols);
+  if ( R1 < toprow ) R1 = toprow;
+  if ( R2 > botrow ) R2 = botrow;
+  if ( R1 <= R2 ) redraw_range(R1, R2, leftcol, rightcol);
+}
+
+/**
+  Tells the table that the data of rows \p R1 to \p R2 (inclusive) is
+  no longer available, e.g. because it changed. The rows are drawn with
+  draw_placeholder() and requested again with request_rows() when needed.
+  \see async_rows(int)
+*/
+void Fl_Table::rows_unloaded(int R1, int R2) {
+  if ( R1 > R2 ) { int t = R1; R1 = R2; R2 = t; }
+  if ( R1 < 0 ) R1 = 0;
+  if ( R2 >= rows() ) R2 = rows() - 1;
+  if ( R1 > R2 ) return;
+  _rows_requested.set(R1, R2+1, 0);
+  if ( !_rows_loaded.set(R1, R2+1, 0) ) return;         // not loaded
+  if ( R1 < toprow ) R1 = toprow;
+  if ( R2 > botrow ) R2 = botrow;
+  if ( R1 <= R2 ) redraw_range(R1, R2, leftcol, rightcol);
+}
+
+/**
+  Returns 1 if the data of row \p R is available, 0 if not.
+  Always returns 1 if async_rows() is disabled.
+*/
+int Fl_Table::row_loaded(int R) const {
+  if ( !_async_rows ) return(1);
+  return(_rows_loaded.contains(R));
+}
+
+/**
+  Draws the cell at row \p R, column \p C while its row is not loaded.
+  The default fills the cell with the table's color() and draws a gray
+  bar in place of the data. Override this to draw something else.
+  \see async_rows(int)
+*/
+void Fl_Table::draw_placeholder(int R, int C, int X, int Y, int W, int H) {
+  fl_push_clip(X, Y, W, H);
+  fl_color(color());
+  fl_rectf(X, Y, W, H);
+  fl_color(fl_color_average(color(), FL_FOREGROUND_COLOR, 0.85f));
+  int bh = H / 3;
+  fl_rectf(X + 4, Y + (H - bh) / 2, (W - 8) * 2 / 3, bh);
+  fl_pop_clip();
+}
+
+// Call request_rows() for rows that are visible or about to become
+// visible, and have neither been loaded nor requested yet.
+//
+//    Half a page above and below the visible rows is prefetched, plus
+//    twice the rows scrolled since the last request in the direction
+//    of scrolling (up to 4 pages), so fast scrolling asks further ahead.
+//    Visible rows are requested first.
+//
+void Fl_Table::_request_rows() {
+  if ( rows() <= 0 ) return;
+  int top = toprow, bot = botrow < rows() ? botrow : rows() - 1;
+  if ( top < 0 ) top = 0;
+  if ( top > bot ) return;
+  int page = bot - top + 1;
+  int moved = top - _async_lasttop;
+  _async_lasttop = top;
+  int before = page / 2, after = page / 2;
+  if ( moved > 0 ) after  += ( moved * 2 < page * 4 ) ? moved * 2 : page * 4;
+  if ( moved < 0 ) before += ( -moved * 2 < page * 4 ) ? -moved * 2 : page * 4;
+  for ( int pass = 0; pass < 2; pass++ ) {
+    int r1 = top, r2 = bot;
+    if ( pass == 1 ) {
+      r1 = ( top - before > 0 ) ? top - before : 0;
+      r2 = ( bot + after < rows() - 1 ) ? bot + after : rows() - 1;
+    }
+    int r = r1;
+    while ( r <= r2 ) {
+      // Skip rows that are loaded or requested
+      int skip;
+      while ( ( skip = _rows_loaded.end_of(_rows_requested.end_of(r)) ) != r ) r = skip;
+      if ( r > r2 ) break;
+      // Request rows up to the next loaded or requested row
+      int end = r2 + 1, n;
+      if ( ( n = _rows_loaded.next(r) ) != -1 && n < end ) end = n;
+      if ( ( n = _rows_requested.next(r) ) != -1 && n < end ) end = n;
+      _rows_requested.set(r, end, 1);
+      request_rows(r, end - 1);
+      r = end;
+    }
+  }
+}
+
 /**
   See if the cell at row \p r and column \p c is selected.
   \returns 1 if the cell is selected, 0 if not.
@@ -1252,6 +1912,23 @@ void Fl_Table::set_selection(int row_top, int col_left, int row_bot, int col_rig
 */
 void Fl_Table::draw() {
     int scrollsize = _scrollbar_size ? _scrollbar_size : Fl::scrollbar_size();
+  // Only scrolled? Then move what's on screen, and draw what's exposed (see below)
+  //    Not possible with fractional scaling, like Fl_Scroll::draw(),
+  //    or when scrolled by a fraction of a pixel.
+  //
+  int scrolled = 0;
+  double dx = _drawn_hpos - hscrollbar->value();
+  double dy = _drawn_vpos - vscrollbar->value();
+  if ( (damage() & FL_DAMAGE_SCROLL) ) {
+    float scale = Fl_Surface_Device::surface()->driver()->scale();
+    if ( (damage() & ~(FL_DAMAGE_SCROLL|FL_DAMAGE_CHILD)) || scale != int(scale) ||
+         dx != int(dx) || dy != int(dy) ) {
+      clear_damage(damage() | FL_DAMAGE_ALL);
+    } else {
+      scrolled = 1;
+      clear_damage(FL_DAMAGE_CHILD);    // Fl_Group::draw(): only update scrollbars
+    }
+  }
   // Check if scrollbar size changed
   if ( ( vscrollbar && (scrollsize != vscrollbar->w()) ) ||
        ( hscrollbar && (scrollsize != hscrollbar->h()) ) ) {
@@ -1259,6 +1936,8 @@ void Fl_Table::draw() {
     table_resized();
   }
 
+  if ( _async_rows ) _request_rows();           // ask for rows coming into view
+
   draw_cell(CONTEXT_STARTPAGE, 0, 0,            // let user's drawing routine
             tix, tiy, tiw, tih);                // prep new page
 
@@ -1280,7 +1959,7 @@ void Fl_Table::draw() {
   //    Do this after Fl_Group::draw() so we draw over scrollbars
   //    that leak around the border.
   //
-  if ( ! table->visible() ) {
+  if ( ! table->visible() && ! scrolled ) {
     if ( damage() & FL_DAMAGE_ALL || damage() & FL_DAMAGE_CHILD ) {
       draw_box(table->box(), tox, toy, tow, toh, table->color());
     }
@@ -1288,6 +1967,19 @@ void Fl_Table::draw() {
   // Clip all further drawing to the inner widget dimensions
   fl_push_clip(wix, wiy, wiw, wih);
   {
+    // Scrolled? Move headers and cells, draw the exposed ones
+    if ( scrolled ) {
+      int X,Y,W,H;
+      if ( row_header() ) {
+        get_bounds(CONTEXT_ROW_HEADER, X, Y, W, H);
+        fl_scroll(X, Y, W, H, 0, int(dy), _draw_area_cb, this);
+      }
+      if ( col_header() ) {
+        get_bounds(CONTEXT_COL_HEADER, X, Y, W, H);
+        fl_scroll(X, Y, W, H, int(dx), 0, _draw_area_cb, this);
+      }
+      fl_scroll(tix, tiy, tiw, tih, int(dx), int(dy), _draw_area_cb, this);
+    }
     // Only redraw a few cells?
     if ( ! ( damage() & FL_DAMAGE_ALL ) && _redraw_leftcol != -1 ) {
       fl_push_clip(tix, tiy, tiw, tih);
@@ -1332,6 +2024,8 @@ void Fl_Table::draw() {
         }
       }
       fl_pop_clip();
+    }
+    if ( damage() & FL_DAMAGE_ALL || scrolled ) {
       // Draw little rectangle in corner of headers
       if ( row_header() && col_header() ) {
         fl_rectf(wix, wiy, row_header_width(), col_header_height(), color());
@@ -1386,6 +2080,8 @@ void Fl_Table::draw() {
               tix, tiy, tiw, tih);              // routines cleanup
 
     _redraw_leftcol = _redraw_rightcol = _redraw_toprow = _redraw_botrow = -1;
+    _drawn_hpos = hscrollbar->value();
+    _drawn_vpos = vscrollbar->value();
   }
   fl_pop_clip();
 }
@@ -38,30 +38,17 @@
 #define PRINTEVENT
 #endif
 
-// An STL-ish vector without templates (private to Fl_Table_Row)
-
-void Fl_Table_Row::CharVector::copy(char *newarr, int newsize) {
-  size(newsize);
-  memcpy(arr, newarr, newsize * sizeof(char));
-}
-
-Fl_Table_Row::CharVector::~CharVector() {       // DTOR
-  if (arr) free(arr);
-  arr = 0;
-}
-
-void Fl_Table_Row::CharVector::size(int count) {
-  if (count != _size) {
-    arr = (char*)realloc(arr, (unsigned)count * sizeof(char));
-    _size = count;
-  }
+// Redraw the rows in [start,end) that are visible
+void Fl_Table_Row::redraw_rows(int start, int end) {
+  if ( start < toprow ) start = toprow;
+  if ( end > botrow + 1 ) end = botrow + 1;
+  if ( start < end ) redraw_range(start, end - 1, leftcol, rightcol);
 }
 
-
 // Is row selected?
 int Fl_Table_Row::row_selected(int row) {
   if ( row < 0 || row >= rows() ) return(-1);
-  return(_rowselect[row]);
+  return(_rowselect.contains(row));
 }
 
 // Change row selection type
@@ -69,20 +56,15 @@ void Fl_Table_Row::type(TableRowSelectMode val) {
   _selectmode = val;
   switch ( _selectmode ) {
     case SELECT_NONE: {
-      for ( int row=0; row<rows(); row++ ) {
-        _rowselect[row] = 0;
-      }
+      _rowselect.truncate(0);
       redraw();
       break;
     }
     case SELECT_SINGLE: {
-      int count = 0;
-      for ( int row=0; row<rows(); row++ ) {
-        if ( _rowselect[row] ) {
-          if ( ++count > 1 ) {  // only one allowed
-            _rowselect[row] = 0;
-          }
-        }
+      if ( _rowselect.size() > 0 ) {            // only one allowed
+        int row = _rowselect.start(0);
+        _rowselect.truncate(0);
+        _rowselect.set(row, row+1, 1);
       }
       redraw();
       break;
@@ -112,34 +94,24 @@ int Fl_Table_Row::select_row(int row, int flag) {
       return(-1);
 
     case SELECT_SINGLE: {
-      int oldval;
-      for ( int t=0; t<rows(); t++ ) {
-        if ( t == row ) {
-          oldval = _rowselect[row];
-          if ( flag == 2 ) { _rowselect[row] ^= 1; }
-          else             { _rowselect[row] = flag; }
-          if ( oldval != _rowselect[row] ) {
-            redraw_range(row, row, leftcol, rightcol);
-            ret = 1;
-          }
-        }
-        else if ( _rowselect[t] ) {
-          _rowselect[t] = 0;
-          redraw_range(t, t, leftcol, rightcol);
-        }
+      int oldval = _rowselect.contains(row);
+      int newval = ( flag == 2 ) ? !oldval : ( flag ? 1 : 0 );
+      // Deselect any other selected row
+      if ( _rowselect.size() > 0 && ( _rowselect.start(0) != row || _rowselect.end(0) != row+1 ) ) {
+        redraw_rows(_rowselect.start(0), _rowselect.end(_rowselect.size()-1));
+        _rowselect.truncate(0);
+      }
+      if ( _rowselect.set(row, row+1, newval) ) {
+        redraw_rows(row, row+1);
+        ret = 1;
       }
       break;
     }
 
     case SELECT_MULTI: {
-      int oldval = _rowselect[row];
-      if ( flag == 2 ) { _rowselect[row] ^= 1; }
-      else             { _rowselect[row] = flag; }
-      if ( _rowselect[row] != oldval ) {                // select state changed?
-        if ( row >= toprow && row <= botrow ) {         // row visible?
-          // Extend partial redraw range
-          redraw_range(row, row, leftcol, rightcol);
-        }
+      if ( _rowselect.set(row, row+1, (flag == 2) ? 2 : (flag ? 1 : 0)) ) {
+        // Extend partial redraw range
+        redraw_rows(row, row+1);
         ret = 1;
       }
     }
@@ -147,6 +119,41 @@ int Fl_Table_Row::select_row(int row, int flag) {
   return(ret);
 }
 
+// Change selection state for rows 'from' to 'to' (inclusive)
+//
+//     flag and return value: same as select_row()
+//
+int Fl_Table_Row::select_rows(int from, int to, int flag) {
+  if ( from > to ) { int t = from; from = to; to = t; }
+  if ( from < 0 ) from = 0;
+  if ( to >= rows() ) to = rows() - 1;
+  if ( from > to ) { return(-1); }
+  switch ( _selectmode ) {
+    case SELECT_NONE:
+      return(-1);
+
+    case SELECT_SINGLE:
+      return(select_row(to, flag));
+
+    case SELECT_MULTI:
+      break;
+  }
+  if ( ! _rowselect.set(from, to+1, (flag == 2) ? 2 : (flag ? 1 : 0)) ) return(0);
+  redraw_rows(from, to+1);
+  return(1);
+}
+
+// Return the first selected row after 'row', or -1 if none
+int Fl_Table_Row::next_selected_row(int row) const {
+  if ( row < -1 ) row = -1;
+  return(_rowselect.next(row));
+}
+
+// Return the number of selected rows
+int Fl_Table_Row::selected_rows() const {
+  return(_rowselect.count());
+}
+
 // Select all rows to a known state
 void Fl_Table_Row::select_all_rows(int flag) {
   switch ( _selectmode ) {
@@ -158,19 +165,7 @@ void Fl_Table_Row::select_all_rows(int flag) {
       //FALLTHROUGH
 
     case SELECT_MULTI: {
-      char changed = 0;
-      if ( flag == 2 ) {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          _rowselect[row] ^= 1;
-        }
-        changed = 1;
-      } else {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          changed |= (_rowselect[row] != flag)?1:0;
-          _rowselect[row] = flag;
-        }
-      }
-      if ( changed ) {
+      if ( _rowselect.set(0, rows(), (flag == 2) ? 2 : (flag ? 1 : 0)) ) {
         redraw();
       }
     }
@@ -180,8 +175,7 @@ void Fl_Table_Row::select_all_rows(int flag) {
 // Set number of rows
 void Fl_Table_Row::rows(int val) {
   Fl_Table::rows(val);
-  while ( val > (int)_rowselect.size() ) { _rowselect.push_back(0); }   // enlarge
-  while ( val < (int)_rowselect.size() ) { _rowselect.pop_back(); }     // shrink
+  _rowselect.truncate(val);                     // forget rows that are gone
 }
 
 // Handle events
@@ -238,9 +232,7 @@ int Fl_Table_Row::handle(int event) {
                   srow = _last_row;
                   erow = R;
                 }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(srow, erow, 1);
               }
               break;
             }
@@ -304,9 +296,7 @@ int Fl_Table_Row::handle(int event) {
                   srow = _last_row;
                   erow = R;
                 }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(srow, erow, 1);
               }
               break;
           }
@@ -67,31 +67,171 @@ static int min(int i1, int i2)
 #endif
 
 
-static char *undobuffer;
-static int undobufferlength;
-static Fl_Text_Buffer *undowidget;
-static int undoat;              // points after insertion
-static int undocut;             // number of characters deleted there
-static int undoinsert;          // number of characters inserted
-static int undoyankcut;         // length of valid contents of buffer, even if undocut=0
+/*
+ Undo history.
+
+ Every buffer keeps its own list of undo actions. An action is a compact
+ record of one edit: the position, the number of bytes inserted there, and
+ a copy of the bytes that were deleted. Inserted text is not copied, it is
+ read back from the buffer when the action is undone. Consecutive typing and
+ consecutive deletions at the cursor are merged into a single action.
+
+ The list is bounded by a number of levels and by the memory used by the
+ deleted text; the oldest actions are dropped first.
+ */
+class Fl_Text_Undo_Action {
+public:
+  Fl_Text_Undo_Action() :
+    undobuffer(NULL),
+    undobufferlength(0),
+    undoat(0),
+    undocut(0),
+    undoinsert(0),
+    undoyankcut(0)
+  { }
+
+  ~Fl_Text_Undo_Action() {
+    if (undobuffer)
+      free(undobuffer);
+  }
+
+  char *undobuffer;
+  int undobufferlength;
+  int undoat;         // points after insertion
+  int undocut;        // number of characters deleted there
+  int undoinsert;     // number of characters inserted
+  int undoyankcut;    // length of valid contents of buffer, even if undocut=0
+
+  /*
+   Resize the undo buffer to match at least the requested size.
+   */
+  void undobuffersize(int n)
+  {
+    if (n > undobufferlength) {
+      if (undobuffer) {
+        do {
+          undobufferlength *= 2;
+        } while (undobufferlength < n);
+        undobuffer = (char *) realloc(undobuffer, undobufferlength);
+      } else {
+        undobufferlength = n + 9;
+        undobuffer = (char *) malloc(undobufferlength);
+      }
+    }
+  }
+
+  /*
+   Release the unused part of the undo buffer when the action is closed.
+   */
+  void compact()
+  {
+    int n = max(undocut, undoyankcut) + 1;
+    if (undobuffer && undobufferlength > n) {
+      undobuffer = (char *) realloc(undobuffer, n);
+      undobufferlength = n;
+    }
+  }
+
+  void clear()
+  {
+    if (undobuffer)
+      free(undobuffer);
+    undobuffer = NULL;
+    undobufferlength = 0;
+    undoat = undocut = undoinsert = undoyankcut = 0;
+  }
+
+  bool empty() const { return !undocut && !undoinsert; }
+
+  int memory() const { return (int) sizeof(*this) + undobufferlength; }
+};
+
 
 /*
- Resize the undo buffer to match at least the requested size.
+ A bounded stack of undo actions, oldest action first.
  */
-static void undobuffersize(int n)
-{
-  if (n > undobufferlength) {
-    if (undobuffer) {
-      do {
-        undobufferlength *= 2;
-      } while (undobufferlength < n);
-      undobuffer = (char *) realloc(undobuffer, undobufferlength);
-    } else {
-      undobufferlength = n + 9;
-      undobuffer = (char *) malloc(undobufferlength);
+class Fl_Text_Undo_Action_List {
+  Fl_Text_Undo_Action **list_;
+  int size_;
+  int alloc_;
+  int memory_;
+
+public:
+  int max_levels;
+  int max_memory;
+
+  Fl_Text_Undo_Action_List() :
+    list_(NULL),
+    size_(0),
+    alloc_(0),
+    memory_(0),
+    max_levels(1000),
+    max_memory(16 * 1024 * 1024)
+  { }
+
+  ~Fl_Text_Undo_Action_List() {
+    clear();
+    if (list_)
+      free(list_);
+  }
+
+  int size() const { return size_; }
+
+  /*
+   Add an action at the top of the stack, dropping the oldest actions if the
+   stack grows beyond its limits. The list takes ownership of the action.
+   */
+  void push(Fl_Text_Undo_Action *action)
+  {
+    action->compact();
+    if (size_ == alloc_) {
+      alloc_ = alloc_ ? alloc_ * 2 : 16;
+      list_ = (Fl_Text_Undo_Action **) realloc(list_, alloc_ * sizeof(Fl_Text_Undo_Action *));
+    }
+    list_[size_++] = action;
+    memory_ += action->memory();
+    trim();
+  }
+
+  /*
+   Remove the action at the top of the stack and return it, or NULL.
+   The caller takes ownership of the action.
+   */
+  Fl_Text_Undo_Action *pop()
+  {
+    if (!size_)
+      return NULL;
+    Fl_Text_Undo_Action *action = list_[--size_];
+    memory_ -= action->memory();
+    return action;
+  }
+
+  /*
+   Drop the oldest actions until the stack is within its limits.
+   The newest action is always kept.
+   */
+  void trim()
+  {
+    int n = 0;
+    while (size_ - n > 1 && (size_ - n > max_levels || memory_ > max_memory)) {
+      memory_ -= list_[n]->memory();
+      delete list_[n];
+      n++;
+    }
+    if (n) {
+      size_ -= n;
+      memmove(list_, list_ + n, size_ * sizeof(Fl_Text_Undo_Action *));
     }
   }
-}
+
+  void clear()
+  {
+    for (int i = 0; i < size_; i++)
+      delete list_[i];
+    size_ = 0;
+    memory_ = 0;
+  }
+};
 
 static void def_transcoding_warning_action(Fl_Text_Buffer *text)
 {
@@ -123,6 +263,16 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
   mPredeleteCbArgs = NULL;
   mCursorPosHint = 0;
   mCanUndo = 1;
+  mUndoApplying = 0;
+  mUndo = new Fl_Text_Undo_Action();
+  mUndoList = new Fl_Text_Undo_Action_List();
+  mRedoList = new Fl_Text_Undo_Action_List();
+  mTransactionLevel = 0;
+  mTxStart = -1;
+  mTxOldEnd = mTxNewEnd = 0;
+  mTxDeletedText = NULL;
+  mTxDeletedAlloc = 0;
+  mSaveJob = NULL;
   input_file_was_transcoded = 0;
   transcoding_warning_action = def_transcoding_warning_action;
 }
@@ -133,6 +283,8 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
  */
 Fl_Text_Buffer::~Fl_Text_Buffer()
 {
+  if (mSaveJob)
+    finish_save();
   free(mBuf);
   if (mNModifyProcs != 0) {
     delete[]mModifyProcs;
@@ -142,6 +294,11 @@ Fl_Text_Buffer::~Fl_Text_Buffer()
     delete[] mPredeleteProcs;
     delete[] mPredeleteCbArgs;
   }
+  delete mUndo;
+  delete mUndoList;
+  delete mRedoList;
+  if (mTxDeletedText)
+    free(mTxDeletedText);
 }
 
 
@@ -187,6 +344,11 @@ void Fl_Text_Buffer::text(const char *t)
   /* Zero all of the existing selections */
   update_selections(0, deletedLength, 0);
 
+  /* The undo history refers to the old text */
+  mUndo->clear();
+  mUndoList->clear();
+  mRedoList->clear();
+
   /* Call the saved display routine(s) to update the screen */
   call_modify_callbacks(0, deletedLength, insertedLength, 0, deletedText);
   free((void *) deletedText);
@@ -355,6 +517,9 @@ void Fl_Text_Buffer::replace(int start, int end, const char *text)
 
   call_predelete_callbacks(start, end - start);
   const char *deletedText = text_range(start, end);
+  // a replacement is never merged with preceding deletions
+  if (mCanUndo)
+    new_undo_action();
   remove_(start, end);
   int nInserted = insert_(start, text);
   mCursorPosHint = start + nInserted;
@@ -443,48 +608,106 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
 
 
 /*
- Take the previous changes and undo them. Return the previous
- cursor position in cursorPos. Returns 1 if the undo was applied.
+ Revert the changes recorded in an undo action. The reverse operation is
+ recorded in mUndo. Return the previous cursor position in cursorPos.
  CursorPos will be at a character boundary.
  */
-int Fl_Text_Buffer::undo(int *cursorPos)
+void Fl_Text_Buffer::apply_undo(Fl_Text_Undo_Action *action, int *cursorPos)
 {
-  if (undowidget != this || (!undocut && !undoinsert && !mCanUndo))
-    return 0;
-
-  int ilen = undocut;
-  int xlen = undoinsert;
-  int b = undoat - xlen;
+  int ilen = action->undocut;
+  int xlen = action->undoinsert;
+  int b = action->undoat - xlen;
 
-  if (xlen && undoyankcut && !ilen) {
-    ilen = undoyankcut;
+  if (xlen && action->undoyankcut && !ilen) {
+    ilen = action->undoyankcut;
   }
 
+  mUndoApplying = 1;
   if (xlen && ilen) {
-    undobuffersize(ilen + 1);
-    undobuffer[ilen] = 0;
-    char *tmp = fl_strdup(undobuffer);
-    replace(b, undoat, tmp);
-    if (cursorPos)
-      *cursorPos = mCursorPosHint;
-    free(tmp);
+    action->undobuffersize(ilen + 1);
+    action->undobuffer[ilen] = 0;
+    replace(b, action->undoat, action->undobuffer);
   } else if (xlen) {
-    remove(b, undoat);
-    if (cursorPos)
-      *cursorPos = mCursorPosHint;
+    remove(b, action->undoat);
   } else if (ilen) {
-    undobuffersize(ilen + 1);
-    undobuffer[ilen] = 0;
-    insert(undoat, undobuffer);
-    if (cursorPos)
-      *cursorPos = mCursorPosHint;
-    undoyankcut = 0;
+    action->undobuffersize(ilen + 1);
+    action->undobuffer[ilen] = 0;
+    insert(action->undoat, action->undobuffer);
   }
+  mUndoApplying = 0;
+  if (cursorPos)
+    *cursorPos = mCursorPosHint;
+}
+
+
+/*
+ Take the previous changes and undo them. Return the previous
+ cursor position in cursorPos. Returns 1 if the undo was applied.
+ CursorPos will be at a character boundary.
+ */
+int Fl_Text_Buffer::undo(int *cursorPos)
+{
+  if (!mCanUndo)
+    return 0;
+
+  if (mUndo->empty()) {
+    Fl_Text_Undo_Action *prev = mUndoList->pop();
+    if (!prev)
+      return 0;
+    delete mUndo;
+    mUndo = prev;
+  }
+
+  Fl_Text_Undo_Action *action = mUndo;
+  mUndo = new Fl_Text_Undo_Action();
+  apply_undo(action, cursorPos);
+  delete action;
+
+  // what was recorded while undoing is the action that redoes the change
+  mRedoList->push(mUndo);
+  mUndo = new Fl_Text_Undo_Action();
+  return 1;
+}
+
+
+/*
+ Take the last undone changes and apply them again. Return the previous
+ cursor position in cursorPos. Returns 1 if the redo was applied.
+ CursorPos will be at a character boundary.
+ */
+int Fl_Text_Buffer::redo(int *cursorPos)
+{
+  if (!mCanUndo)
+    return 0;
+
+  Fl_Text_Undo_Action *action = mRedoList->pop();
+  if (!action)
+    return 0;
+
+  new_undo_action();
+  apply_undo(action, cursorPos);
+  delete action;
 
+  // close the action so that further typing does not merge with it
+  new_undo_action();
   return 1;
 }
 
 
+/*
+ Close the current undo action, if it recorded anything, and start a new one.
+ */
+void Fl_Text_Buffer::new_undo_action()
+{
+  if (mUndo->empty()) {
+    mUndo->clear();
+    return;
+  }
+  mUndoList->push(mUndo);
+  mUndo = new Fl_Text_Undo_Action();
+}
+
+
 /*
  Set a flag if undo function will work.
  */
@@ -492,8 +715,80 @@ void Fl_Text_Buffer::canUndo(char flag)
 {
   mCanUndo = flag;
   // disabling undo also clears the last undo operation!
-  if (!mCanUndo && undowidget==this)
-    undowidget = 0;
+  if (!mCanUndo) {
+    mUndo->clear();
+    mUndoList->clear();
+    mRedoList->clear();
+  }
+}
+
+
+bool Fl_Text_Buffer::can_undo() const
+{
+  return mCanUndo && (!mUndo->empty() || mUndoList->size() > 0);
+}
+
+
+bool Fl_Text_Buffer::can_redo() const
+{
+  return mCanUndo && mRedoList->size() > 0;
+}
+
+
+/**
+ Sets the maximum number of undo steps kept by this buffer.
+
+ When more text modifications are made, the oldest ones can no longer be
+ undone. The most recent text modification can always be undone.
+ The default is 1000 steps.
+ \param n maximum number of undo steps
+ \see undo_memory(int)
+ */
+void Fl_Text_Buffer::undo_levels(int n)
+{
+  if (n < 0)
+    n = 0;
+  mUndoList->max_levels = mRedoList->max_levels = n;
+  mUndoList->trim();
+  mRedoList->trim();
+}
+
+
+/**
+ Returns the maximum number of undo steps kept by this buffer.
+ */
+int Fl_Text_Buffer::undo_levels() const
+{
+  return mUndoList->max_levels;
+}
+
+
+/**
+ Sets the maximum memory in bytes used by the undo history of this buffer.
+
+ The memory used by an undo step is mostly the text that was deleted.
+ Inserted text is not copied. When the limit is exceeded, the oldest undo
+ steps are dropped. The most recent text modification can always be undone.
+ The default is 16 MB.
+ \param bytes maximum memory in bytes
+ \see undo_levels(int)
+ */
+void Fl_Text_Buffer::undo_memory(int bytes)
+{
+  if (bytes < 0)
+    bytes = 0;
+  mUndoList->max_memory = mRedoList->max_memory = bytes;
+  mUndoList->trim();
+  mRedoList->trim();
+}
+
+
+/**
+ Returns the maximum memory in bytes used by the undo history of this buffer.
+ */
+int Fl_Text_Buffer::undo_memory() const
+{
+  return mUndoList->max_memory;
 }
 
 
@@ -1053,6 +1348,121 @@ int Fl_Text_Buffer::rewind_lines(int startPos, int nLines)
 }
 
 
+/*
+ Decode a UTF-8 search string into an array of lower case UCS-4 characters.
+ Returns the number of characters. The array must be free'd.
+ */
+static int fold_search_string(const char *searchString, unsigned int **folded)
+{
+  int n = 0;
+  unsigned int *u = (unsigned int *) malloc((strlen(searchString) + 1) * sizeof(unsigned int));
+  for (const char *sp = searchString; *sp; ) {
+    int l;
+    u[n++] = fl_tolower(fl_utf8decode(sp, 0, &l));
+    sp += l;
+  }
+  *folded = u;
+  return n;
+}
+
+
+/*
+ Compare the buffer at pos with a folded search string, ignoring case.
+ Returns the position after the match, or -1 if the text does not match.
+ */
+int Fl_Text_Buffer::match_folded_(int pos, const unsigned int *folded, int n) const
+{
+  for (int i = 0; i < n; i++) {
+    if (pos >= mLength)
+      return -1;
+    const char *src = address(pos);
+    int l;
+    if ((unsigned char)*src < 0x80) {
+      l = 1;
+      if ((unsigned int)fl_tolower((unsigned char)*src) != folded[i])
+        return -1;
+    } else {
+      unsigned int c = fl_utf8decode(src, 0, &l);
+      if ((unsigned int)fl_tolower(c) != folded[i])
+        return -1;
+    }
+    pos += l;
+  }
+  return pos;
+}
+
+
+/*
+ Find a matching string in the buffer that starts between startPos and
+ endPos - 1 and ends before or at endPos. Case sensitive searches compare
+ bytes using the Boyer-Moore-Horspool algorithm; since UTF-8 lead bytes
+ never match continuation bytes, every match starts at a character boundary.
+ */
+int Fl_Text_Buffer::search_forward_(int startPos, int endPos,
+                                    const char *searchString, int *foundPos,
+                                    int *foundEnd, int matchCase) const
+{
+  if (startPos < 0)
+    startPos = 0;
+  if (endPos > mLength)
+    endPos = mLength;
+
+  if (matchCase) {
+    const unsigned char *u = (const unsigned char *) searchString;
+    int m = (int) strlen(searchString);
+    if (m == 0) {
+      if (startPos >= endPos)
+        return 0;
+      *foundPos = *foundEnd = startPos;
+      return 1;
+    }
+    int skip[256];
+    for (int i = 0; i < 256; i++)
+      skip[i] = m;
+    for (int i = 0; i < m - 1; i++)
+      skip[u[i]] = m - 1 - i;
+    int gapLen = mGapEnd - mGapStart;
+    for (int p = startPos; p <= endPos - m; ) {
+      int i = m - 1;
+      for (; i >= 0; i--) {
+        int bp = p + i;
+        if ((unsigned char)mBuf[bp < mGapStart ? bp : bp + gapLen] != u[i])
+          break;
+      }
+      if (i < 0) {
+        *foundPos = p;
+        *foundEnd = p + m;
+        return 1;
+      }
+      int bp = p + m - 1;
+      p += skip[(unsigned char)mBuf[bp < mGapStart ? bp : bp + gapLen]];
+    }
+    return 0;
+  }
+
+  unsigned int *folded;
+  int n = fold_search_string(searchString, &folded);
+  int found = 0;
+  for (; startPos < endPos; startPos = next_char(startPos)) {
+    // quick check for the common case of an ASCII first character
+    if (n && folded[0] < 0x80) {
+      unsigned char c = *address(startPos);
+      if (c < 0x80 && (unsigned int)tolower(c) != folded[0])
+        continue;
+    }
+    int e = match_folded_(startPos, folded, n);
+    if (e >= 0 && e <= endPos) {
+      *foundPos = startPos;
+      *foundEnd = e;
+      found = 1;
+      break;
+    }
+  }
+  free(folded);
+  return found;
+}
+
+
 /*
  Find a matching string in the buffer.
  */
@@ -1064,50 +1474,12 @@ int Fl_Text_Buffer::search_forward(int startPos, const char *searchString,
 
   if (!searchString)
     return 0;
-  int bp;
-  const char *sp;
-  if (matchCase) {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), l))
-          break;
-        sp += l; bp += l;
-      }
-      startPos = next_char(startPos);
-    }
-  } else {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &l);
-        if (fl_tolower(b)!=fl_tolower(s))
-          break;
-        sp += l;
-        bp = next_char(bp);
-      }
-      startPos = next_char(startPos);
-    }
-  }
-  return 0;
+  int foundEnd;
+  return search_forward_(startPos, mLength, searchString, foundPos, &foundEnd,
+                         matchCase);
 }
 
+
 int Fl_Text_Buffer::search_backward(int startPos, const char *searchString,
                                     int *foundPos, int matchCase) const
 {
@@ -1116,51 +1488,103 @@ int Fl_Text_Buffer::search_backward(int startPos, const char *searchString,
 
   if (!searchString)
     return 0;
-  int bp;
-  const char *sp;
+
   if (matchCase) {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), l))
-          break;
-        sp += l; bp += l;
-      }
-      startPos = prev_char(startPos);
+    // Boyer-Moore-Horspool, scanning from the end of the buffer
+    const unsigned char *u = (const unsigned char *) searchString;
+    int m = (int) strlen(searchString);
+    if (m == 0) {
+      if (startPos < 0)
+        return 0;
+      *foundPos = startPos;
+      return 1;
     }
-  } else {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &l);
-        if (fl_tolower(b)!=fl_tolower(s))
+    int skip[256];
+    for (int i = 0; i < 256; i++)
+      skip[i] = m;
+    for (int i = m - 1; i > 0; i--)
+      skip[u[i]] = i;
+    int gapLen = mGapEnd - mGapStart;
+    for (int p = min(startPos, mLength - m); p >= 0; ) {
+      int i = 0;
+      for (; i < m; i++) {
+        int bp = p + i;
+        if ((unsigned char)mBuf[bp < mGapStart ? bp : bp + gapLen] != u[i])
           break;
-        sp += l;
-        bp = next_char(bp);
       }
-      startPos = prev_char(startPos);
+      if (i == m) {
+        *foundPos = p;
+        return 1;
+      }
+      p -= skip[(unsigned char)mBuf[p < mGapStart ? p : p + gapLen]];
+    }
+    return 0;
+  }
+
+  unsigned int *folded;
+  int n = fold_search_string(searchString, &folded);
+  int found = 0;
+  if (startPos > mLength)
+    startPos = mLength;
+  for (; startPos >= 0; startPos = prev_char(startPos)) {
+    if (match_folded_(startPos, folded, n) >= 0) {
+      *foundPos = startPos;
+      found = 1;
+      break;
     }
   }
-  return 0;
+  free(folded);
+  return found;
 }
 
 
+/**
+ \brief Finds all occurrences of a string in a range of the buffer.
+
+ Matches do not overlap. Each match is returned as a pair of byte offsets,
+ the start of the match and the position after its end; with \p matchCase
+ set to 0 the byte length of a match can differ from the length of
+ \p searchString. This can be used to highlight all matches of a search.
+
+ Searching does not modify the buffer. Several threads may search the same
+ buffer concurrently, for instance in separate ranges, as long as no thread
+ modifies it at the same time.
+
+ \param[in] startPos byte offset where the search starts
+ \param[in] endPos byte offset where the search ends, matches end before or
+             at this position
+ \param[in] searchString UTF-8 string that we want to find
+ \param[out] matches returns a newly allocated array of 2 * (number of matches)
+             offsets, or NULL if nothing was found; free it using free()
+ \param[in] matchCase if set, match character case
+ \return number of matches
+ \since 1.4.0
+ */
+int Fl_Text_Buffer::search_all(int startPos, int endPos,
+                               const char *searchString, int **matches,
+                               int matchCase) const
+{
+  IS_UTF8_ALIGNED2(this, (startPos))
+  IS_UTF8_ALIGNED(searchString)
+
+  *matches = NULL;
+  if (!searchString || !*searchString)
+    return 0;
+
+  int n = 0, alloc = 0;
+  int pos, end;
+  while (search_forward_(startPos, endPos, searchString, &pos, &end, matchCase)) {
+    if (n + 2 > alloc) {
+      alloc = alloc ? 2 * alloc : 64;
+      *matches = (int *) realloc(*matches, alloc * sizeof(int));
+    }
+    (*matches)[n++] = pos;
+    (*matches)[n++] = end;
+    startPos = end;
+  }
+  return n / 2;
+}
+
 
 /*
  Insert a string into the buffer.
@@ -1190,15 +1614,21 @@ int Fl_Text_Buffer::insert_(int pos, const char *text)
   update_selections(pos, 0, insertedLength);
 
   if (mCanUndo) {
-    if (undowidget == this && undoat == pos && undoinsert) {
-      undoinsert += insertedLength;
+    if (!mUndoApplying)
+      mRedoList->clear();
+    if (mUndo->undoat == pos && mUndo->undoinsert) {
+      // continue typing at the same position
+      mUndo->undoinsert += insertedLength;
     } else {
-      undoinsert = insertedLength;
-      undoyankcut = (undoat == pos) ? undocut : 0;
+      // text inserted where text was just deleted makes this a replace action
+      int yankcut = (mUndo->undoat == pos) ? mUndo->undocut : 0;
+      if (!yankcut)
+        new_undo_action();
+      mUndo->undoinsert = insertedLength;
+      mUndo->undoyankcut = yankcut;
     }
-    undoat = pos + insertedLength;
-    undocut = 0;
-    undowidget = this;
+    mUndo->undoat = pos + insertedLength;
+    mUndo->undocut = 0;
   }
 
   return insertedLength;
@@ -1213,35 +1643,48 @@ void Fl_Text_Buffer::remove_(int start, int end)
 {
   /* if the gap is not contiguous to the area to remove, move it there */
 
+  char *undodest = NULL;
   if (mCanUndo) {
-    if (undowidget == this && undoat == end && undocut) {
-      undobuffersize(undocut + end - start + 1);
-      memmove(undobuffer + end - start, undobuffer, undocut);
-      undocut += end - start;
+    Fl_Text_Undo_Action *u = mUndo;
+    if (!mUndoApplying)
+      mRedoList->clear();
+    if (u->undoat == end && u->undocut && !u->undoinsert) {
+      // backspace: prepend the deleted text to the current action
+      u->undobuffersize(u->undocut + end - start + 1);
+      memmove(u->undobuffer + end - start, u->undobuffer, u->undocut);
+      undodest = u->undobuffer;
+      u->undocut += end - start;
+    } else if (u->undoat == start && u->undocut && !u->undoinsert) {
+      // forward delete: append the deleted text to the current action
+      u->undobuffersize(u->undocut + end - start + 1);
+      undodest = u->undobuffer + u->undocut;
+      u->undocut += end - start;
     } else {
-      undocut = end - start;
-      undobuffersize(undocut);
+      new_undo_action();
+      u = mUndo;
+      u->undocut = end - start;
+      u->undobuffersize(u->undocut);
+      undodest = u->undobuffer;
     }
-    undoat = start;
-    undoinsert = 0;
-    undoyankcut = 0;
-    undowidget = this;
+    u->undoat = start;
+    u->undoinsert = 0;
+    u->undoyankcut = 0;
   }
 
   if (start > mGapStart) {
-    if (mCanUndo)
-      memcpy(undobuffer, mBuf + (mGapEnd - mGapStart) + start,
+    if (undodest)
+      memcpy(undodest, mBuf + (mGapEnd - mGapStart) + start,
              end - start);
     move_gap(start);
   } else if (end < mGapStart) {
-    if (mCanUndo)
-      memcpy(undobuffer, mBuf + start, end - start);
+    if (undodest)
+      memcpy(undodest, mBuf + start, end - start);
     move_gap(end);
   } else {
     int prelen = mGapStart - start;
-    if (mCanUndo) {
-      memcpy(undobuffer, mBuf + start, prelen);
-      memcpy(undobuffer + prelen, mBuf + mGapEnd, end - start - prelen);
+    if (undodest) {
+      memcpy(undodest, mBuf + start, prelen);
+      memcpy(undodest + prelen, mBuf + mGapEnd, end - start - prelen);
     }
   }
 
@@ -1353,7 +1796,6 @@ void Fl_Text_Buffer::remove_selection_(Fl_Text_Selection * sel)
   if (!sel->position(&start, &end))
     return;
   remove(start, end);
-  //undoyankcut = undocut;
 }
 
 
@@ -1389,6 +1831,14 @@ void Fl_Text_Buffer::call_modify_callbacks(int pos, int nDeleted,
                                            int nInserted, int nRestyled,
                                            const char *deletedText) const {
   IS_UTF8_ALIGNED2(this, pos)
+  if (mTransactionLevel) {
+    // the deleted range was added by call_predelete_callbacks()
+    if (nInserted || nDeleted)
+      mTxNewEnd += nInserted - nDeleted;
+    else if (nRestyled)
+      extend_transaction(pos, min(pos + nRestyled, mLength));
+    return;
+  }
   for (int i = 0; i < mNModifyProcs; i++)
     (*mModifyProcs[i]) (pos, nInserted, nDeleted, nRestyled,
                         deletedText, mCbArgs[i]);
@@ -1400,11 +1850,138 @@ void Fl_Text_Buffer::call_modify_callbacks(int pos, int nDeleted,
  Unicode safe.
  */
 void Fl_Text_Buffer::call_predelete_callbacks(int pos, int nDeleted) const {
+  if (mTransactionLevel) {
+    extend_transaction(pos, pos + nDeleted);
+    return;
+  }
   for (int i = 0; i < mNPredeleteProcs; i++)
     (*mPredeleteProcs[i]) (pos, nDeleted, mPredeleteCbArgs[i]);
 }
 
 
+/**
+ \brief Starts a group of changes that are reported to the modify callbacks at once.
+
+ All insertions, deletions, replacements and selection changes made until
+ the matching end_transaction() are merged into a single changed area. The
+ modify and pre-delete callbacks are not called during the transaction;
+ end_transaction() calls them once for the whole area. This avoids that
+ attached Fl_Text_Display widgets recalculate their layout for every
+ single change, for instance in a "replace all" operation.
+
+ Transactions can be nested; the changes are reported when the outermost
+ transaction ends.
+
+ \note Attached Fl_Text_Display widgets are not updated during the
+   transaction. Do not query or move their cursor or scroll position until
+   end_transaction() was called.
+
+ \see end_transaction(), transaction_level()
+ */
+void Fl_Text_Buffer::begin_transaction()
+{
+  mTransactionLevel++;
+}
+
+
+/**
+ \brief Ends a group of changes and reports them to the modify callbacks.
+
+ When the outermost transaction ends, the pre-delete callbacks are called
+ while the buffer temporarily holds the original text of the changed area,
+ then the modify callbacks are called once with the position, the number
+ of deleted and inserted bytes, and the deleted text of the whole area.
+
+ \see begin_transaction()
+ */
+void Fl_Text_Buffer::end_transaction()
+{
+  if (mTransactionLevel <= 0 || --mTransactionLevel > 0)
+    return;
+  if (mTxStart < 0)
+    return;
+
+  int pos = mTxStart;
+  int nDeleted = mTxOldEnd - mTxStart;
+  int nInserted = mTxNewEnd - mTxStart;
+  mTxStart = -1;
+  if (!nDeleted && !nInserted)
+    return;
+  mTxDeletedText[nDeleted] = '\0';
+
+  if (mNPredeleteProcs > 0) {
+    // Predelete callbacks expect to see the text that is about to be
+    // deleted, so swap the original text back in while they are called.
+    Fl_Text_Selection primary = mPrimary, secondary = mSecondary, hilite = mHighlight;
+    char canUndo = mCanUndo;
+    mCanUndo = 0;
+    char *insertedText = text_range(pos, pos + nInserted);
+    remove_(pos, pos + nInserted);
+    insert_(pos, mTxDeletedText);
+    call_predelete_callbacks(pos, nDeleted);
+    remove_(pos, pos + nDeleted);
+    insert_(pos, insertedText);
+    free(insertedText);
+    mCanUndo = canUndo;
+    mPrimary = primary;
+    mSecondary = secondary;
+    mHighlight = hilite;
+  }
+
+  call_modify_callbacks(pos, nDeleted, nInserted, 0, mTxDeletedText);
+}
+
+
+/*
+ Extend the area changed by the current transaction to include the range
+ start to end of the current text. Text in that range outside of the
+ changed area still is the original text, which is saved for the modify
+ callbacks.
+ */
+void Fl_Text_Buffer::extend_transaction(int start, int end) const
+{
+  if (mTxStart < 0) {
+    mTxStart = mTxOldEnd = mTxNewEnd = start;
+  }
+  int front = max(mTxStart - start, 0);
+  int back = max(end - mTxNewEnd, 0);
+  int oldLength = mTxOldEnd - mTxStart;
+  int n = oldLength + front + back + 1;
+  if (n > mTxDeletedAlloc) {
+    mTxDeletedAlloc = max(n, 2 * mTxDeletedAlloc);
+    mTxDeletedText = (char *) realloc(mTxDeletedText, mTxDeletedAlloc);
+  }
+  if (front) {
+    memmove(mTxDeletedText + front, mTxDeletedText, oldLength);
+    copy_range_(mTxDeletedText, start, mTxStart);
+    mTxStart = start;
+    oldLength += front;
+  }
+  if (back) {
+    copy_range_(mTxDeletedText + oldLength, mTxNewEnd, end);
+    mTxOldEnd += back;
+    mTxNewEnd = end;
+  }
+}
+
+
+/*
+ Copy the text between start and end to dest, without a trailing nul.
+ */
+void Fl_Text_Buffer::copy_range_(char *dest, int start, int end) const
+{
+  if (end <= mGapStart) {
+    memcpy(dest, mBuf + start, end - start);
+  } else if (start >= mGapStart) {
+    memcpy(dest, mBuf + start + (mGapEnd - mGapStart), end - start);
+  } else {
+    int part1Length = mGapStart - start;
+    memcpy(dest, mBuf + start, part1Length);
+    memcpy(dest + part1Length, mBuf + mGapEnd, end - start - part1Length);
+  }
+}
+
+
 /*
  Redisplay a new selected area.
  Unicode safe.
@@ -1800,6 +2377,7 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
 /*
  Write text to file.
  Unicode safe.
+ The text is written directly from both sides of the gap, without copying.
  */
 int Fl_Text_Buffer::outputfile(const char *file,
                                int start, int end,
@@ -1807,10 +2385,14 @@ int Fl_Text_Buffer::outputfile(const char *file,
   FILE *fp;
   if (!(fp = fl_fopen(file, "w")))
     return 1;
-  for (int n; (n = min(end - start, buflen)); start += n) {
-    const char *p = text_range(start, start + n);
-    int r = (int) fwrite(p, 1, n, fp);
-    free((void *) p);
+  if (start < 0)
+    start = 0;
+  if (end > mLength)
+    end = mLength;
+  for (int n; (n = min(end - start, buflen)) > 0; start += n) {
+    if (start < mGapStart && start + n > mGapStart)
+      n = mGapStart - start;
+    int r = (int) fwrite(address(start), 1, n, fp);
     if (r != n)
       break;
   }
@@ -1821,6 +2403,129 @@ int Fl_Text_Buffer::outputfile(const char *file,
 }
 
 
+/*
+ State of an asynchronous save started by outputfile_async().
+ */
+class Fl_Text_Save_Job {
+public:
+  Fl_Text_Buffer *buffer;
+  FILE *fp;
+  char *text;           // snapshot of the saved text
+  int length;
+  int written;
+  int chunk;
+  Fl_Text_Save_Cb cb;
+  void *cbArg;
+
+  /*
+   Write the next chunk, or all remaining text if all is true.
+   Returns -1 while the save is in progress, or the final status, in which
+   case the job has been deleted.
+   */
+  int step(bool all)
+  {
+    do {
+      int n = min(length - written, chunk);
+      if (n > 0 && (int) fwrite(text + written, 1, n, fp) != n)
+        break;
+      written += n;
+      if (written < length && !all) {
+        if (cb)
+          cb(buffer, written, length, -1, cbArg);
+        return -1;
+      }
+    } while (written < length);
+
+    Fl::remove_idle(idle_cb, this);
+    buffer->mSaveJob = NULL;
+    int e = ferror(fp) ? 2 : 0;
+    fclose(fp);
+    free(text);
+    if (cb)
+      cb(buffer, written, length, e, cbArg);
+    delete this;
+    return e;
+  }
+
+  static void idle_cb(void *data)
+  {
+    ((Fl_Text_Save_Job *)data)->step(false);
+  }
+};
+
+
+/**
+ \brief Writes a portion of the text buffer to a file in the background.
+
+ The text between \p start and \p end is copied when this method is called,
+ so the buffer can be modified while the file is being written. The file is
+ written in chunks of \p buflen bytes while FLTK is idle, so the user
+ interface keeps responding even for very large buffers.
+
+ The callback \p cb is called after each chunk with \p status -1, and once
+ more when the file was completely written with the final status:
+  - 0 on success
+  - 2 indicates error occurred while writing data (data was partially saved)
+
+ Only one asynchronous save can be in progress for a buffer. If another
+ save is in progress, it is completed (see finish_save()) before the new
+ one is started. Deleting the buffer also completes the save.
+
+ \param file name of the file
+ \param start byte offset of the first character to save
+ \param end byte offset after the last character to save
+ \param cb progress and completion callback, may be NULL
+ \param cbArg user data passed to \p cb
+ \param buflen number of bytes written per chunk
+ \return 0 if the save was started, 1 if the file could not be opened
+   for writing (no data saved, \p cb is not called)
+ \see savefile_async(), saving(), finish_save()
+ \since 1.4.0
+ */
+int Fl_Text_Buffer::outputfile_async(const char *file, int start, int end,
+                                     Fl_Text_Save_Cb cb, void *cbArg,
+                                     int buflen)
+{
+  if (mSaveJob)
+    finish_save();
+
+  FILE *fp;
+  if (!(fp = fl_fopen(file, "w")))
+    return 1;
+
+  Fl_Text_Save_Job *job = new Fl_Text_Save_Job;
+  job->buffer = this;
+  job->fp = fp;
+  // clamp the range like text_range() does, the text may contain NUL bytes
+  if (start < 0 || start > mLength) start = end = 0;
+  if (end < start) { int temp = start; start = end; end = temp; }
+  if (end > mLength) end = mLength;
+  job->text = text_range(start, end);
+  job->length = end - start;
+  job->written = 0;
+  job->chunk = buflen > 0 ? buflen : 1024*1024;
+  job->cb = cb;
+  job->cbArg = cbArg;
+  mSaveJob = job;
+  Fl::add_idle(Fl_Text_Save_Job::idle_cb, job);
+  return 0;
+}
+
+
+/**
+ \brief Writes the rest of an asynchronous save immediately.
+
+ Does nothing if no asynchronous save is in progress.
+ \return the final status of the save, see outputfile_async()
+ */
+int Fl_Text_Buffer::finish_save()
+{
+  if (!mSaveJob)
+    return 0;
+  return mSaveJob->step(true);
+}
+
+
 /*
  Return the previous character position.
  Unicode safe.
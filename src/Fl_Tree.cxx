@@ -106,12 +106,22 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
   _toh = _tih = H - Fl::box_dh(box());
   _tree_w = -1;
   _tree_h = -1;
+  _item_widgets = 0;
+  _selcount_valid = 0;
+  _populate_cb   = 0;
+  _populate_data = 0;
+  _lazy_items    = 0;
+  _lazy_count    = 0;
+  _lazy_size     = 0;
+  _lazy_budget   = 0;
   end();
 }
 
 /// Destructor.
 Fl_Tree::~Fl_Tree() {
+  _lazy_count = 0;                              // deleted items need not unregister
   if ( _root ) { delete _root; _root = 0; }
+  if ( _lazy_items ) { free((void*)_lazy_items); _lazy_items = 0; }
 }
 
 /// Extend the selection between and including \p 'from' and \p 'to'
@@ -218,6 +228,127 @@ int Fl_Tree::extend_selection(Fl_Tree_Item *from, Fl_Tree_Item *to,
   return(changed);
 }
 
+/// Select, deselect or toggle the items between and including \p 'from' and \p 'to'.
+///
+/// Like extend_selection(), but the callback is invoked only once after
+/// all items were changed, instead of once for each item.
+/// \p 'to' can be above or below \p 'from'; only the items in between are walked.<br>
+/// Handles calling redraw() if anything changed.
+///
+/// \param[in] from    Starting item
+/// \param[in] to      Ending item
+/// \param[in] val     0=deselect, 1=select, 2=toggle
+/// \param[in] visible true=affect only open(), visible items,<br>
+///                    false=affect open or closed items (default)
+/// \param[in] docallback -- A flag that determines if the callback() is invoked or not:
+///     -   0 - the callback() is not invoked
+///     -   1 - the callback() is invoked once if any item changed state (default),
+///             callback_reason() will be FL_TREE_REASON_BATCH
+/// \returns The number of items whose selection states were changed, if any.
+/// \see extend_selection(), apply()
+/// \version 1.4.0
+///
+int Fl_Tree::select_range(Fl_Tree_Item *from, Fl_Tree_Item *to,
+                          int val, bool visible, int docallback) {
+  // Find 'to' by walking both ways, so we don't walk the whole tree
+  Fl_Tree_Item *dn = from, *up = from;
+  while ( dn != to && up != to && (dn || up) ) {
+    if ( dn ) dn = next_item(dn, FL_Down, visible);
+    if ( up ) up = next_item(up, FL_Up, visible);
+  }
+  if ( dn != to && up != to ) return(0);        // 'to' not found
+  int dir = (dn == to) ? FL_Down : FL_Up;
+  int changed = 0;
+  Fl_Tree_Item *first_changed = 0;
+  for ( Fl_Tree_Item *item=from; item; item = next_item(item, dir, visible) ) {
+    int was = item->is_selected();
+    switch (val) {
+      case 0:  item->deselect();      break;
+      case 1:  item->select();        break;
+      case 2:  item->select_toggle(); break;
+    }
+    if ( item->is_selected() != was ) {
+      if ( !first_changed ) first_changed = item;
+      ++changed;
+    }
+    if ( item == to ) break;
+  }
+  if ( changed ) {
+    set_changed();
+    redraw();
+    if ( docallback ) do_callback_for_item(first_changed, FL_TREE_REASON_BATCH);
+  }
+  return(changed);
+}
+
+/**
+ Select, deselect, open or close \p 'item' and its children as requested by \p 'cb'.
+
+ \p 'cb' is called with \p 'data' for each item in tree order, and returns an
+ or'ed combination of ::Fl_Tree_Apply values for the item. Items are opened
+ before their children are visited, so that children created on demand
+ (see populate_callback()) are visited too. \p 'cb' must not add or remove items.
+
+ Unlike calling select(), open() etc. for each item, the callback() is invoked
+ only once, after all items were changed.<br>
+ Handles calling redraw() if anything changed.
+
+ Example: select all items whose label starts with "tmp":
+ \par
+ \code
+ static int select_tmp(Fl_Tree_Item *item, void*) {
+     if ( item->label() && strncmp(item->label(), "tmp", 3) == 0 )
+         return(FL_TREE_APPLY_SELECT);
+     return(FL_TREE_APPLY_NONE);
+ }
+ [..]
+ tree->apply(0, select_tmp);
+ \endcode
+
+ \param[in] item The item to start with. If NULL, first() is used.
+ \param[in] cb The callback that decides the changes for each item.
+ \param[in] data Optional user data passed to \p 'cb'.
+ \param[in] docallback -- A flag that determines if the callback() is invoked or not:
+     -   0 - the callback() is not invoked
+     -   1 - the callback() is invoked once if any item changed (default),
+             callback_reason() will be FL_TREE_REASON_BATCH
+ \returns The number of items that changed.
+ \see select_range(), open_to_depth()
+ \version 1.4.0
+*/
+int Fl_Tree::apply(Fl_Tree_Item *item, Fl_Tree_Apply_Callback *cb, void *data, int docallback) {
+  item = item ? item : first();                 // NULL? use first()
+  if ( ! item ) return(0);
+  Fl_Tree_Item *start = item, *first_changed = 0;
+  int changed = 0, selchanged = 0;
+  while ( item ) {
+    int what = cb(item, data);
+    int wassel = item->is_selected(), wasopen = item->is_open();
+    if ( what & FL_TREE_APPLY_SELECT )                      item->select();
+    if ( what & FL_TREE_APPLY_DESELECT )                    item->deselect();
+    if ( (what & FL_TREE_APPLY_OPEN)  && item->is_close() ) item->open();
+    if ( (what & FL_TREE_APPLY_CLOSE) && item->is_open() )  item->close();
+    if ( item->is_selected() != wassel ) selchanged = 1;
+    if ( item->is_selected() != wassel || item->is_open() != wasopen ) {
+      if ( !first_changed ) first_changed = item;
+      ++changed;
+    }
+    // Next item in start's subtree
+    if ( !(what & FL_TREE_APPLY_SKIP_CHILDREN) && item->has_children() ) {
+      item = item->child(0);
+    } else {
+      while ( item != start && !item->_next_sibling ) item = item->_parent;
+      item = (item == start) ? 0 : item->_next_sibling;
+    }
+  }
+  if ( changed ) {
+    if ( selchanged ) set_changed();
+    redraw();
+    if ( docallback ) do_callback_for_item(first_changed, FL_TREE_REASON_BATCH);
+  }
+  return(changed);
+}
+
 enum { PUSHED_NONE=0, PUSHED_OPEN_CLOSE, PUSHED_USER_ICON, PUSHED_LABEL };
 /// Standard FLTK event handler for this widget.
 /// \todo add Fl_Widget_Tracker (see Fl_Browser_.cxx::handle())
@@ -329,8 +460,8 @@ int Fl_Tree::handle(int e) {
               set_item_focus(next_visible_item(_item_focus, ekey));     // next item up|dn
               if ( _item_focus ) {                                      // item in focus?
                 // Autoscroll
-                int itemtop = _item_focus->y();
-                int itembot = _item_focus->y()+_item_focus->h();
+                int itemtop = item_top(_item_focus);
+                int itembot = itemtop+_item_focus->h();
                 if ( itemtop < y() ) { show_item_top(_item_focus); }
                 if ( itembot > y()+h() ) { show_item_bottom(_item_focus); }
                 // Extend selection
@@ -650,6 +781,10 @@ void Fl_Tree::calc_dimensions() {
 /// The tree hierarchy's size only changes when items are added/removed,
 /// open/closed, label contents or font sizes changed, margins changed, etc.
 ///
+/// The walk also records the vertical range of every open item, so that
+/// draw() and find_clicked() only visit the items in view. Apps that change
+/// the geometry of items behind the tree's back must call recalc_tree().
+///
 /// This calculation involves walking the *entire* tree from top to bottom,
 /// potentially a slow calculation if the tree has many items (potentially
 /// hundreds of thousands), and should therefore be called sparingly.
@@ -665,6 +800,7 @@ void Fl_Tree::calc_dimensions() {
 void Fl_Tree::calc_tree() {
   // Set tree width and height to zero, and recalc just _tox/_toy/_tow/_toh for now.
   _tree_w = _tree_h = -1;
+  _item_widgets = 0;
   calc_dimensions();
   if ( !_root ) return;
   // Walk the tree to determine its width and height.
@@ -800,6 +936,8 @@ Fl_Tree_Item* Fl_Tree::root() {
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
   if ( _root ) clear();
   _root = newitem;
+  _selcount_valid = 0;          // count the new root's selected items
+  recalc_tree();
 }
 
 /** Adds a new item, given a menu style \p 'path'.
@@ -933,6 +1071,7 @@ int Fl_Tree::remove(Fl_Tree_Item *item) {
 ///
 void Fl_Tree::clear() {
   if ( ! _root ) return;
+  _lazy_count = 0;                      // deleted items need not unregister
   _root->clear_children();
   delete _root; _root = 0;
   _item_focus = 0;
@@ -949,6 +1088,125 @@ void Fl_Tree::clear_children(Fl_Tree_Item *item) {
   }
 }
 
+/// Set the callback that creates the children of items marked with
+/// Fl_Tree_Item::lazy_children(1).
+///
+/// The callback is invoked with the item and \p 'data' the first time such
+/// an item is opened, just before it opens. It would normally add() the
+/// item's children, marking those that have children of their own with
+/// lazy_children(1) as well. It may also add nothing and start loading
+/// the children in the background; see "LAZY CHILDREN" in the class description.
+///
+/// Once populated, the item's children are kept until the item is unload()ed,
+/// either explicitly or because lazy_item_budget() is exceeded.
+///
+/// \param[in] cb The populate callback, or NULL to disable populating.
+/// \param[in] data Optional user data passed to the callback.
+/// \see Fl_Tree_Item::lazy_children(), unload(), lazy_item_budget()
+/// \version 1.4.0
+///
+void Fl_Tree::populate_callback(Fl_Tree_Populate_Callback *cb, void *data) {
+  _populate_cb   = cb;
+  _populate_data = data;
+}
+
+/// Delete the children of \p 'item' that were created by the populate callback.
+///
+/// The item is closed and marked with Fl_Tree_Item::lazy_children(1) again,
+/// so that the populate callback recreates its children the next time it is
+/// opened. Selection and other state of the deleted items is lost.
+///
+/// \param[in] item The item to unload. Must not be NULL.
+/// \returns 1 if the children were deleted, 0 if the item's children
+///          were not created by the populate callback.
+/// \see populate_callback(), lazy_item_budget()
+/// \version 1.4.0
+///
+int Fl_Tree::unload(Fl_Tree_Item *item) {
+  if ( ! item->is_flag(Fl_Tree_Item::POPULATED) ) return(0);
+  lazy_forget(item);
+  item->set_flag(Fl_Tree_Item::POPULATED, 0);
+  item->clear_children();               // also forgets populated descendants
+  item->lazy_children(1);               // closes item
+  redraw();
+  return(1);
+}
+
+/// Set the maximum number of lazily created items kept in memory.
+///
+/// Every item created by the populate callback counts against the budget
+/// while its parent remains populated. When an item is opened and the budget
+/// is exceeded, the least recently opened items that are collapsed, i.e. closed
+/// themselves or inside a closed parent, are unload()ed until the budget is met
+/// again. Items that are open and visible are never unloaded, so the budget can
+/// be exceeded when the user opens more items than it allows.
+///
+/// \param[in] val Maximum number of items, or 0 for no limit (default).
+/// \see populate_callback(), unload()
+/// \version 1.4.0
+///
+void Fl_Tree::lazy_item_budget(int val) {
+  _lazy_budget = val;
+  lazy_trim(0);
+}
+
+// Internal: Called by Fl_Tree_Item::open() for items with lazy or populated children.
+//    Records 'item' as the most recently opened populated item, and calls
+//    the populate callback if the item is opened for the first time.
+//
+void Fl_Tree::lazy_open(Fl_Tree_Item *item) {
+  int populate = item->is_flag(Fl_Tree_Item::LAZY);
+  if ( item->is_flag(Fl_Tree_Item::POPULATED) )
+    lazy_forget(item);                  // re-added as most recently opened below
+  item->set_flag(Fl_Tree_Item::LAZY, 0);
+  item->set_flag(Fl_Tree_Item::POPULATED, 1);
+  if ( _lazy_count >= _lazy_size ) {
+    _lazy_size = _lazy_size ? _lazy_size * 2 : 16;
+    _lazy_items = (Fl_Tree_Item**)realloc((void*)_lazy_items, _lazy_size * sizeof(Fl_Tree_Item*));
+  }
+  _lazy_items[_lazy_count++] = item;
+  if ( populate && _populate_cb ) _populate_cb(item, _populate_data);
+}
+
+// Internal: Remove 'item' from the list of populated items.
+//    Called when the item is unloaded or destroyed.
+//
+void Fl_Tree::lazy_forget(Fl_Tree_Item *item) {
+  for ( int t=_lazy_count-1; t>=0; t-- ) {      // most recently opened items last
+    if ( _lazy_items[t] == item ) {
+      memmove(_lazy_items+t, _lazy_items+t+1, (_lazy_count-t-1) * sizeof(Fl_Tree_Item*));
+      _lazy_count--;
+      return;
+    }
+  }
+}
+
+// Internal: Unload collapsed populated items, least recently opened first,
+//    until no more than lazy_item_budget() items are loaded.
+//    'keep' (if not NULL) and its parents are never unloaded.
+//
+void Fl_Tree::lazy_trim(Fl_Tree_Item *keep) {
+  if ( _lazy_budget <= 0 ) return;
+  int total = 0;
+  int t;
+  for ( t=0; t<_lazy_count; t++ ) total += _lazy_items[t]->children();
+  for ( t=0; t<_lazy_count && total > _lazy_budget; t++ ) {
+    Fl_Tree_Item *item = _lazy_items[t];
+    int collapsed = 0;
+    Fl_Tree_Item *p;
+    for ( p=keep; p && p != item; p=p->parent() ) { }
+    if ( p ) continue;                          // item is 'keep' or one of its parents
+    for ( p=item; p; p=p->parent() ) {
+      if ( p->is_close() ) { collapsed = 1; break; }
+    }
+    if ( ! collapsed ) continue;
+    unload(item);                               // may also unload entries before t
+    total = 0;                                  // recount, start over
+    for ( t=0; t<_lazy_count; t++ ) total += _lazy_items[t]->children();
+    t = -1;
+  }
+}
+
 /**
  Find the item, given a menu style path, e.g. "/Parent/Child/item".
  There is both a const and non-const version of this method.
@@ -1380,34 +1638,79 @@ Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
  \param[in] dir  The direction to go.
                  FL_Up for moving up the tree,
                  FL_Down for down the tree (default)
+ The tree keeps a count of the selected items in each subtree, so subtrees
+ without selected items are skipped instead of walked.
+
  \returns The next selected item, or 0 if there are no more selected items.
  \see first_selected_item(), last_selected_item(), next_selected_item()
  \version 1.3.3
 */
 Fl_Tree_Item *Fl_Tree::next_selected_item(Fl_Tree_Item *item, int dir) {
+  if ( ! _root ) return(0);
+  if ( ! _selcount_valid ) {            // (re)count selected items in each subtree
+    count_selected(_root);
+    _selcount_valid = 1;
+  }
+  // Subtrees without selected items are skipped
+  Fl_Tree_Item *c;
   switch (dir) {
     case FL_Down:
       if ( ! item ) {
-        if ( ! (item = first()) ) return(0);
+        item = _root;
         if ( item->is_selected() ) return(item);
       }
-      while ( (item = item->next()) )
-        if ( item->is_selected() )
-          return(item);
+      if ( item->_nselected > item->is_selected() ) {   // selected children?
+        c = item->child(0);
+      } else {                                          // skip item's subtree
+        for ( c = item; c && !c->_next_sibling; c = c->_parent ) { }
+        c = c ? c->_next_sibling : 0;
+      }
+      while ( c ) {
+        if ( c->_nselected == 0 ) {                     // skip c's subtree
+          for ( ; c && !c->_next_sibling; c = c->_parent ) { }
+          c = c ? c->_next_sibling : 0;
+        } else if ( c->is_selected() ) {
+          return(c);
+        } else {
+          c = c->child(0);                              // selected children
+        }
+      }
       return(0);
     case FL_Up:
       if ( ! item ) {
-        if ( ! (item = last()) ) return(0);
-        if ( item->is_selected() ) return(item);
+        if ( _root->_nselected == 0 ) return(0);
+        c = _root;                                      // find last selected item below
+      } else {
+        c = 0;
+        for ( ; item->_parent; item = item->_parent ) {
+          for ( c = item->_prev_sibling; c && c->_nselected == 0; c = c->_prev_sibling ) { }
+          if ( c ) break;                               // sibling subtree with selected items
+          if ( item->_parent->is_selected() ) return(item->_parent);
+        }
+        if ( ! c ) return(0);
       }
-      while ( (item = item->prev()) )
-        if ( item->is_selected() )
-          return(item);
-      return(0);
+      // Descend to the last selected item in c's subtree
+      while ( c->_nselected > c->is_selected() ) {
+        Fl_Tree_Item *k = c->child(c->children()-1);
+        while ( k->_nselected == 0 ) k = k->_prev_sibling;
+        c = k;
+      }
+      return(c);
   }
   return(0);
 }
 
+// Internal: Count the selected items in 'item's subtree,
+//    saving the count in each item for next_selected_item().
+//
+int Fl_Tree::count_selected(Fl_Tree_Item *item) {
+  int count = item->is_selected();
+  for ( int t=0; t<item->children(); t++ )
+    count += count_selected(item->child(t));
+  item->_nselected = count;
+  return(count);
+}
+
 /**
  Returns the currently selected items as an array of \p 'ret_items'.
 
@@ -1582,6 +1885,41 @@ int Fl_Tree::close(const char *path, int docallback) {
   return(close(item, docallback));              // handles recalc_tree()
 }
 
+// INTERNAL: apply() callback for open_to_depth()
+//    data[0] is the depth of the start item, data[1] the number of levels to open.
+//
+static int open_to_depth_cb(Fl_Tree_Item *item, void *data) {
+  int *d = (int*)data;
+  if ( item->depth() - d[0] >= d[1] ) return(FL_TREE_APPLY_SKIP_CHILDREN);
+  return(FL_TREE_APPLY_OPEN);
+}
+
+/// Open \p 'item' and its children down to \p 'depth' levels below it.
+///
+/// Opening is done with apply(), so the callback is invoked only once.
+/// Items deeper down keep their open or closed state.<br>
+/// Handles calling redraw() if anything changed.
+///
+/// \param[in] item The item to open. If NULL, first() is used.
+/// \param[in] depth The number of levels below \p 'item' to show,
+///                  e.g. 1 opens \p 'item' only.
+/// \param[in] docallback -- A flag that determines if the callback() is invoked or not:
+///     -   0 - callback() is not invoked
+///     -   1 - callback() is invoked once if any item was opened (default),
+///             callback_reason() will be FL_TREE_REASON_BATCH
+/// \returns The number of items that were opened.
+/// \see apply(), open()
+/// \version 1.4.0
+///
+int Fl_Tree::open_to_depth(Fl_Tree_Item *item, int depth, int docallback) {
+  item = item ? item : first();                 // NULL? use first()
+  if ( ! item ) return(0);
+  int data[2];
+  data[0] = item->depth();
+  data[1] = depth;
+  return(apply(item, open_to_depth_cb, (void*)data, docallback));
+}
+
 /// See if \p 'item' is open.
 ///
 /// Items that are 'open' are themselves not necessarily visible;
@@ -2359,7 +2697,8 @@ void Fl_Tree::item_draw_mode(int mode) {
 int Fl_Tree::displayed(Fl_Tree_Item *item) {
   item = item ? item : first();
   if (!item) return(0);
-  return( (item->y() >= y()) && (item->y() <= (y()+h()-item->h())) ? 1 : 0);
+  int itemtop = item_top(item);
+  return( (itemtop >= y()) && (itemtop <= (y()+h()-item->h())) ? 1 : 0);
 }
 
 /// Adjust the vertical scrollbar so that \p 'item' is visible
@@ -2379,7 +2718,7 @@ int Fl_Tree::displayed(Fl_Tree_Item *item) {
 void Fl_Tree::show_item(Fl_Tree_Item *item, int yoff) {
   item = item ? item : first();
   if (!item) return;
-  int newval = item->y() - y() - yoff + (int)_vscroll->value();
+  int newval = item_top(item) - y() - yoff + (int)_vscroll->value();
   if ( newval < _vscroll->minimum() ) newval = (int)_vscroll->minimum();
   if ( newval > _vscroll->maximum() ) newval = (int)_vscroll->maximum();
   _vscroll->value(newval);
@@ -2683,6 +3022,14 @@ void Fl_Tree::fix_scrollbar_order() {
   }
 }
 
+// Returns the current y position of 'item' in the window. Drawing skips the
+// items scrolled out of view, so their y() may be out of date; use the
+// y ranges from calc_tree() instead when they are up to date.
+int Fl_Tree::item_top(const Fl_Tree_Item *item) const {
+  if ( _tree_w < 0 ) return(item->y());
+  return(_tiy - (int)_vscroll->value() + item->_tree_y[0]);
+}
+
 /// Schedule tree to recalc the entire tree size.
 /// \note Must be using FLTK ABI 1.3.3 or higher for this to be effective.
 ///
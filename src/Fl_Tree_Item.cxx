@@ -8,7 +8,6 @@
 #include <FL/Fl_Tree_Item.H>
 #include <FL/Fl_Tree_Prefs.H>
 #include <FL/Fl_Tree.H>
-#include <FL/fl_string.h>
 
 //////////////////////
 // Fl_Tree_Item.cxx
@@ -34,6 +33,199 @@ static int event_inside(const int xywh[4]) {
   return(Fl::event_inside(xywh[0],xywh[1],xywh[2],xywh[3]));
 }
 
+////////////////////////////////////////////////////////////////////////
+// Item and label storage
+//
+//    Items are allocated from slabs of ITEMS_PER_SLAB items instead of one
+//    malloc() each, and equal labels share one reference counted copy.
+//    Both pools are shared by all trees and are released when the last item
+//    and the last label are destroyed. They are not locked: like widgets,
+//    items may only be created, relabeled and destroyed by the main thread,
+//    or by another thread while it holds Fl::lock().
+//
+////////////////////////////////////////////////////////////////////////
+
+#define ITEMS_PER_SLAB 256
+
+struct Fl_Tree_Item_Slab {
+  Fl_Tree_Item_Slab *next;                      // next slab
+  double items[1];                              // (aligned) start of ITEMS_PER_SLAB items
+};
+
+static Fl_Tree_Item_Slab *item_slabs = 0;       // all slabs
+static void *item_freelist = 0;                 // free items, linked through their first word
+static long item_count = 0;                     // items in use
+
+// Allocate an item from the pool, or with the global operator new if it is
+// of a larger derived class. With 'nothrow' set, returns 0 if out of memory.
+static void *item_alloc(size_t size, int nothrow) {
+  if ( size != sizeof(Fl_Tree_Item) )
+    return(nothrow ? ::operator new(size, std::nothrow) : ::operator new(size));
+  if ( !item_freelist ) {                       // get a new slab
+    size_t slabsize = sizeof(Fl_Tree_Item_Slab) - sizeof(double) + ITEMS_PER_SLAB * sizeof(Fl_Tree_Item);
+    Fl_Tree_Item_Slab *slab = (Fl_Tree_Item_Slab*)(nothrow ? ::operator new(slabsize, std::nothrow)
+                                                           : ::operator new(slabsize));
+    if ( !slab ) return(0);
+    slab->next = item_slabs;
+    item_slabs = slab;
+    char *p = (char*)slab->items;
+    for ( int t=ITEMS_PER_SLAB-1; t>=0; t-- ) {  // add items to free list, first item first
+      void **item = (void**)(p + t * sizeof(Fl_Tree_Item));
+      *item = item_freelist;
+      item_freelist = (void*)item;
+    }
+  }
+  void *item = item_freelist;
+  item_freelist = *(void**)item;
+  item_count++;
+  return(item);
+}
+
+// Return an item to the pool.
+static void item_free(void *p) {
+  *(void**)p = item_freelist;
+  item_freelist = p;
+  if ( --item_count == 0 ) {                    // no items left? release slabs
+    while ( item_slabs ) {
+      Fl_Tree_Item_Slab *next = item_slabs->next;
+      ::operator delete((void*)item_slabs);
+      item_slabs = next;
+    }
+    item_freelist = 0;
+  }
+}
+
+/// Allocate memory for a new item.
+/// Items of class Fl_Tree_Item are allocated from a pool of slabs, which
+/// saves the memory allocator's per-block overhead in large trees.
+/// Larger derived classes are allocated with the global operator new.
+///
+/// The pool is not locked, see Fl_Tree_Item(Fl_Tree*) for the threads
+/// that may create items.
+///
+void *Fl_Tree_Item::operator new(size_t size) {
+  return(item_alloc(size, 0));
+}
+
+/// Allocate memory for a new item, returning NULL if out of memory.
+/// Used by <tt>new(std::nothrow) Fl_Tree_Item(..)</tt>.
+///
+void *Fl_Tree_Item::operator new(size_t size, const std::nothrow_t&) {
+  return(item_alloc(size, 1));
+}
+
+/// Free the memory of an item allocated with operator new.
+/// When the last item of the pool is freed, all slabs are released.
+///
+void Fl_Tree_Item::operator delete(void *p, size_t size) {
+  if ( !p ) return;
+  if ( size != sizeof(Fl_Tree_Item) ) {
+    ::operator delete(p);
+    return;
+  }
+  item_free(p);
+}
+
+/// Free the memory of an item whose constructor failed after
+/// <tt>new(std::nothrow)</tt>. The size is not known here, so the slabs
+/// are searched for the item.
+///
+void Fl_Tree_Item::operator delete(void *p, const std::nothrow_t&) {
+  if ( !p ) return;
+  for ( Fl_Tree_Item_Slab *slab = item_slabs; slab; slab = slab->next ) {
+    char *first = (char*)slab->items;
+    if ( (char*)p >= first && (char*)p < first + ITEMS_PER_SLAB * sizeof(Fl_Tree_Item) ) {
+      item_free(p);
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
+// A label shared by all items with the same label text.
+//    The text follows the struct.
+//
+struct Fl_Tree_Label {
+  int refs;                                     // number of items using this label
+  unsigned hash;                                // hash of the text
+};
+
+static Fl_Tree_Label **label_table = 0;         // open addressing hash table of labels
+static int label_tablesize = 0;                 // size of label_table[] (power of 2)
+static int label_count = 0;                     // labels in label_table[]
+
+static unsigned label_hash(const char *s) {     // FNV-1a
+  unsigned h = 2166136261U;
+  while ( *s ) { h ^= (unsigned char)*s++; h *= 16777619U; }
+  return(h);
+}
+
+static inline const char *label_text(Fl_Tree_Label *l) {
+  return((const char*)(l+1));
+}
+
+static inline Fl_Tree_Label *label_of(const char *text) {
+  return(((Fl_Tree_Label*)text) - 1);
+}
+
+// Return the shared copy of 'name', adding it to the table if needed.
+static const char *label_intern(const char *name) {
+  if ( label_count * 2 >= label_tablesize ) {   // keep table at most half full
+    int newsize = label_tablesize ? label_tablesize * 2 : 256;
+    Fl_Tree_Label **newtable = (Fl_Tree_Label**)calloc(newsize, sizeof(Fl_Tree_Label*));
+    for ( int t=0; t<label_tablesize; t++ ) {
+      Fl_Tree_Label *l = label_table[t];
+      if ( !l ) continue;
+      int i = l->hash & (newsize-1);
+      while ( newtable[i] ) i = (i+1) & (newsize-1);
+      newtable[i] = l;
+    }
+    free((void*)label_table);
+    label_table = newtable;
+    label_tablesize = newsize;
+  }
+  unsigned hash = label_hash(name);
+  int i = hash & (label_tablesize-1);
+  for ( Fl_Tree_Label *l; (l = label_table[i]) != 0; i = (i+1) & (label_tablesize-1) ) {
+    if ( l->hash == hash && strcmp(label_text(l), name) == 0 ) {
+      l->refs++;
+      return(label_text(l));
+    }
+  }
+  size_t len = strlen(name);
+  Fl_Tree_Label *l = (Fl_Tree_Label*)malloc(sizeof(Fl_Tree_Label) + len + 1);
+  l->refs = 1;
+  l->hash = hash;
+  memcpy((char*)(l+1), name, len+1);
+  label_table[i] = l;
+  label_count++;
+  return(label_text(l));
+}
+
+// Release an item's reference to 'text', a label returned by label_intern().
+static void label_release(const char *text) {
+  Fl_Tree_Label *l = label_of(text);
+  if ( --l->refs > 0 ) return;
+  int mask = label_tablesize - 1;
+  int i = l->hash & mask;
+  while ( label_table[i] != l ) i = (i+1) & mask;
+  free((void*)l);
+  label_table[i] = 0;
+  // Close the gap, moving back entries that no longer would be found
+  for ( int j = (i+1) & mask; label_table[j]; j = (j+1) & mask ) {
+    int k = label_table[j]->hash & mask;
+    if ( i <= j ? (i < k && k <= j) : (i < k || k <= j) ) continue;
+    label_table[i] = label_table[j];
+    label_table[j] = 0;
+    i = j;
+  }
+  if ( --label_count == 0 ) {                   // no labels left? release table
+    free((void*)label_table);
+    label_table = 0;
+    label_tablesize = 0;
+  }
+}
+
 /// Constructor.
 /// Makes a new instance of Fl_Tree_Item using defaults from \p 'prefs'.
 /// \deprecated in 1.3.3 ABI -- you must use Fl_Tree_Item(Fl_Tree*) for proper horizontal scrollbar behavior.
@@ -66,6 +258,9 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _label_xywh[1]    = 0;
   _label_xywh[2]    = 0;
   _label_xywh[3]    = 0;
+  _tree_y[0]        = 0;
+  _tree_y[1]        = 0;
+  _nselected        = 0;
   _usericon         = 0;
   _userdeicon       = 0;
   _userdata         = 0;
@@ -81,6 +276,11 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
 /// This must be used instead of the older, deprecated Fl_Tree_Item(Fl_Tree_Prefs)
 /// constructor for proper horizontal scrollbar calculation.
 ///
+/// Items and their labels are kept in pools shared by all trees, which are
+/// not locked. Like widgets, items may only be created, relabeled and
+/// destroyed by the main thread, or by another thread while it holds
+/// Fl::lock().
+///
 /// \version 1.3.3 ABI feature
 ///
 Fl_Tree_Item::Fl_Tree_Item(Fl_Tree *tree) {
@@ -90,7 +290,7 @@ Fl_Tree_Item::Fl_Tree_Item(Fl_Tree *tree) {
 // DTOR
 Fl_Tree_Item::~Fl_Tree_Item() {
   if ( _label ) {
-    free((void*)_label);
+    label_release(_label);
     _label = 0;
   }
   _widget = 0;                  // Fl_Group will handle destruction
@@ -99,13 +299,19 @@ Fl_Tree_Item::~Fl_Tree_Item() {
   // focus item? set to null
   if ( _tree && this == _tree->_item_focus )
     { _tree->_item_focus = 0; }
+  if ( _tree ) {
+    if ( this == _tree->_lastselect )    { _tree->_lastselect = 0; }
+    if ( this == _tree->_callback_item ) { _tree->_callback_item = 0; }
+    if ( is_flag(POPULATED) )            { _tree->lazy_forget(this); }
+  }
   //_children.clear();          // array's destructor handles itself
 }
 
 /// Copy constructor.
 Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _tree             = o->_tree;
-  _label        = o->label() ? fl_strdup(o->label()) : 0;
+  _label        = o->_label;
+  if ( _label ) label_of(_label)->refs++;       // share label
   _labelfont    = o->labelfont();
   _labelsize    = o->labelsize();
   _labelfgcolor = o->labelfgcolor();
@@ -124,6 +330,9 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _label_xywh[1]    = o->_label_xywh[1];
   _label_xywh[2]    = o->_label_xywh[2];
   _label_xywh[3]    = o->_label_xywh[3];
+  _tree_y[0]        = o->_tree_y[0];
+  _tree_y[1]        = o->_tree_y[1];
+  _nselected        = 0;                // counted when added to a tree
   _usericon         = o->usericon();
   _userdata         = o->user_data();
   _parent           = o->_parent;
@@ -152,11 +361,16 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 }
 
 /// Set the label to \p 'name'.
-/// Makes and manages an internal copy of \p 'name'.
+/// Makes and manages an internal copy of \p 'name', which is shared
+/// with other items that have the same label.
 ///
 void Fl_Tree_Item::label(const char *name) {
-  if ( _label ) { free((void*)_label); _label = 0; }
-  _label = name ? fl_strdup(name) : 0;
+  // Keep parent's index of its children's labels up to date
+  int indexed = _parent ? _parent->_children.index_remove(this) : 0;
+  const char *old = _label;
+  _label = name ? label_intern(name) : 0;       // before release: 'name' may be our own label
+  if ( old ) label_release(old);
+  if ( indexed ) _parent->_children.index_add(this);
   recalc_tree();                // may change label geometry
 }
 
@@ -173,7 +387,7 @@ const Fl_Tree_Item *Fl_Tree_Item::child(int index) const {
 /// Clear all the children for this item.
 void Fl_Tree_Item::clear_children() {
   _children.clear();
-  recalc_tree();                // may change tree geometry
+  children_changed();
 }
 
 /// Return the index of the immediate child of this item
@@ -183,13 +397,8 @@ void Fl_Tree_Item::clear_children() {
 /// \version 1.3.0 release
 ///
 int Fl_Tree_Item::find_child(const char *name) {
-  if ( name ) {
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(t);
-  }
-  return(-1);
+  Fl_Tree_Item *item = _children.find(name);
+  return(item ? find_child(item) : -1);
 }
 
 /// Return the /immediate/ child of current item
@@ -199,12 +408,7 @@ int Fl_Tree_Item::find_child(const char *name) {
 /// \version 1.3.3
 ///
 const Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) const {
-  if ( name )
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(child(t));
-  return(0);
+  return(_children.find(name));
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(const char *name) const.
@@ -222,18 +426,10 @@ Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) {
 /// \version 1.3.0 release
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_child_item(char **arr) const {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), *arr) == 0 ) {     // match?
-        if ( *(arr+1) ) {                               // more in arr? descend
-          return(_children[t]->find_child_item(arr+1));
-        } else {                                        // end of arr? done
-          return(_children[t]);
-        }
-      }
-    }
-  }
-  return(0);
+  const Fl_Tree_Item *item = _children.find(*arr);
+  if ( item && *(arr+1) )                               // more in arr? descend
+    return(item->find_child_item(arr+1));
+  return(item);
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(char **arr) const.
@@ -305,7 +501,7 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
                                 Fl_Tree_Item *item) {
   if ( !item )
     { item = new Fl_Tree_Item(_tree); item->label(new_label); }
-  recalc_tree();                // may change tree geometry
+  children_changed();
   item->_parent = this;
   switch ( prefs.sortorder() ) {
     case FL_TREE_SORT_NONE: {
@@ -403,7 +599,7 @@ Fl_Tree_Item *Fl_Tree_Item::insert(const Fl_Tree_Prefs &prefs, const char *new_l
   item->label(new_label);
   item->_parent = this;
   _children.insert(pos, item);
-  recalc_tree();                // may change tree geometry
+  children_changed();
   return(item);
 }
 
@@ -438,6 +634,7 @@ Fl_Tree_Item *Fl_Tree_Item::insert_above(const Fl_Tree_Prefs &prefs, const char
 Fl_Tree_Item* Fl_Tree_Item::deparent(int pos) {
   Fl_Tree_Item *orphan = _children[pos];
   if ( _children.deparent(pos) < 0 ) return NULL;
+  children_changed();
   return orphan;
 }
 
@@ -452,6 +649,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);               // take custody
+  children_changed();
   return 0;
 }
 
@@ -464,7 +662,9 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
 /// \see move_above(), move_below(), move_into(), move(Fl_Tree_Item*,int,int)
 ///
 int Fl_Tree_Item::move(int to, int from) {
-  return _children.move(to, from);
+  int ret = _children.move(to, from);
+  if ( ret == 0 ) recalc_tree();        // may change tree geometry
+  return ret;
 }
 
 /// Move the current item above/below/into the specified 'item',
@@ -626,7 +826,7 @@ Fl_Tree_Item *Fl_Tree_Item::replace_child(Fl_Tree_Item *olditem,
   newitem->_parent = this;
   // replace in array (handles stitching neighboring items)
   _children.replace(pos, newitem);
-  recalc_tree();                        // newitem may have changed tree geometry
+  children_changed();
   return newitem;
 }
 
@@ -638,7 +838,7 @@ int Fl_Tree_Item::remove_child(Fl_Tree_Item *item) {
     if ( child(t) == item ) {
       item->clear_children();
       _children.remove(t);
-      recalc_tree();            // may change tree geometry
+      children_changed();
       return(0);
     }
   }
@@ -653,16 +853,11 @@ int Fl_Tree_Item::remove_child(Fl_Tree_Item *item) {
 /// \version 1.3.3
 ///
 int Fl_Tree_Item::remove_child(const char *name) {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), name) == 0 ) {
-        _children.remove(t);
-        recalc_tree();          // may change tree geometry
-        return(0);
-      }
-    }
-  }
-  return(-1);
+  int t = find_child(name);
+  if ( t < 0 ) return(-1);
+  _children.remove(t);
+  children_changed();
+  return(0);
 }
 
 /// Swap two of our children, given two child index values \p 'ax' and \p 'bx'.
@@ -673,6 +868,7 @@ int Fl_Tree_Item::remove_child(const char *name) {
 ///
 void Fl_Tree_Item::swap_children(int ax, int bx) {
   _children.swap(ax, bx);
+  recalc_tree();                // may change tree geometry
 }
 
 /// Swap two of our immediate children, given item pointers.
@@ -753,6 +949,21 @@ void Fl_Tree_Item::draw_vertical_connector(int x, int y1, int y2, const Fl_Tree_
   }
 }
 
+/// Return the index of the first child whose top (\p bottom=0) or whose
+/// bottom including its open children (\p bottom=1) is below \p Y,
+/// or children() if there is none.
+/// \p Y is relative to the tree's top, like the ranges from Fl_Tree::calc_tree().
+///
+int Fl_Tree_Item::find_child_below(int Y, int bottom) const {
+  int lo = 0, hi = children();
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( _children[mid]->_tree_y[bottom] > Y ) hi = mid;
+    else lo = mid + 1;
+  }
+  return(lo);
+}
+
 /// Find the item that the last event was over.
 /// If \p 'yonly' is 1, only check event's y value, don't care about x.
 /// \param[in] prefs The parent tree's Fl_Tree_Prefs
@@ -763,23 +974,35 @@ void Fl_Tree_Item::draw_vertical_connector(int x, int y1, int y2, const Fl_Tree_
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_clicked(const Fl_Tree_Prefs &prefs, int yonly) const {
   if ( ! is_visible() ) return(0);
+  // Tree geometry up to date? Then use the y ranges from Fl_Tree::calc_tree(),
+  // since items scrolled out of view are not updated by drawing, and only
+  // descend into the children whose range contains the event.
+  int yorigin = 0;
+  char indexed = (_tree && _tree->_tree_w >= 0) ? 1 : 0;
+  int xywh[4] = { _xywh[0], _xywh[1], _xywh[2], _xywh[3] };
+  if ( indexed ) {
+    yorigin = _tree->_tiy - (int)_tree->_vscroll->value();
+    xywh[1] = yorigin + _tree_y[0];
+  }
   if ( is_root() && !prefs.showroot() ) {
     // skip event check if we're root but root not being shown
   } else {
     // See if event is over us
     if ( yonly ) {
-      if ( Fl::event_y() >= _xywh[1] &&
-           Fl::event_y() <= (_xywh[1]+_xywh[3]) ) {
+      if ( Fl::event_y() >= xywh[1] &&
+           Fl::event_y() <= (xywh[1]+xywh[3]) ) {
         return(this);
       }
     } else {
-      if ( event_inside(_xywh) ) {              // event within this item?
+      if ( event_inside(xywh) ) {               // event within this item?
         return(this);                           // found
       }
     }
   }
   if ( is_open() ) {                            // open? check children of this item
-    for ( int t=0; t<children(); t++ ) {
+    int ey = Fl::event_y() - yorigin;
+    for ( int t = indexed ? find_child_below(ey-1, 1) : 0; t<children(); t++ ) {
+      if ( indexed && _children[t]->_tree_y[0] > ey ) break;    // below event? done
       const Fl_Tree_Item *item;
       if ( (item = _children[t]->find_clicked(prefs, yonly)) != NULL)  // recurse into child for descendents
         return(item);                                                  // found?
@@ -856,7 +1079,7 @@ int Fl_Tree_Item::calc_item_height(const Fl_Tree_Prefs &prefs) const {
        H < widget()->h()) {
     H = widget()->h();
   }
-  if ( has_children() && prefs.openicon() && H<prefs.openicon()->h() )
+  if ( (has_children() || is_flag(LAZY)) && prefs.openicon() && H<prefs.openicon()->h() )
     H = prefs.openicon()->h();
   if ( usericon() && H<usericon()->h() )
     H = usericon()->h();
@@ -1000,7 +1223,9 @@ int Fl_Tree_Item::draw_item_content(int render) {
 ///                               calculate tree's max width.
 /// \param[in]     lastchild      Is this item the last child in a subtree?
 /// \param[in]     render         Whether or not to render the item:
-///                               0: no rendering, just calculate size w/out drawing.
+///                               0: no rendering, just calculate size w/out drawing,
+///                                  and record the y ranges used to skip the items
+///                                  scrolled out of view when rendering.
 ///                               1: render item as well as size calc
 ///
 /// \version 1.3.3 ABI feature: modified parameters
@@ -1008,7 +1233,10 @@ int Fl_Tree_Item::draw_item_content(int render) {
 void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
                         int &tree_item_xmax, int lastchild, int render) {
   Fl_Tree_Prefs &prefs = _tree->_prefs;
+  int yorigin = tree()->_tiy - (int)tree()->_vscroll->value();   // tree's top
+  if ( !render ) _tree_y[0] = _tree_y[1] = Y - yorigin;
   if ( !is_visible() ) return;
+  if ( !render && widget() ) tree()->_item_widgets++;
   int tree_top = tree()->_tiy;
   int tree_bot = tree_top + tree()->_tih;
   int H = calc_item_height(prefs);      // height of item
@@ -1112,7 +1340,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
           }
         }
         // Draw collapse icon
-        if ( render && has_children() && prefs.showcollapse() ) {
+        if ( render && (has_children() || is_flag(LAZY)) && prefs.showcollapse() ) {
           // Draw icon image
           if ( is_open() ) {
             if ( active ) prefs.closeicon()->draw(icon_x,icon_y);
@@ -1165,10 +1393,19 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
                            : X;                                 // unless didn't drawthis
     int child_w = W - (child_x-X);
     int child_y_start = Y;
-    for ( int t=0; t<children(); t++ ) {
+    int t0 = 0, t1 = children();
+    if ( render && !tree()->_item_widgets ) {
+      // Skip the children scrolled out of view, using the y ranges from
+      // calc_tree(). Not done if there are widgets, they must all be moved.
+      t0 = find_child_below(tree_top - yorigin - 1, 1);
+      t1 = find_child_below(tree_bot - yorigin, 0);
+      if ( t0 > 0 ) Y = yorigin + _children[t0-1]->_tree_y[1];
+    }
+    for ( int t=t0; t<t1; t++ ) {
       int is_lastchild = ((t+1)==children()) ? 1 : 0;
       _children[t]->draw(child_x, Y, child_w, itemfocus, tree_item_xmax, is_lastchild, render);
     }
+    if ( t1 < children() ) Y = yorigin + _children[children()-1]->_tree_y[1];
     if ( has_children() && is_open() ) {
       Y += prefs.openchild_marginbottom();              // offset below open child tree
     }
@@ -1180,13 +1417,14 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
         draw_vertical_connector(hconn_x, child_y_start, Y, prefs);
     }
   }
+  if ( !render ) _tree_y[1] = Y - yorigin;      // bottom of item and its open children
 }
 
 
 /// Was the event on the 'collapse' button of this item?
 ///
 int Fl_Tree_Item::event_on_collapse_icon(const Fl_Tree_Prefs &prefs) const {
-  if ( is_visible() && is_active() && has_children() && prefs.showcollapse() ) {
+  if ( is_visible() && is_active() && (has_children() || is_flag(LAZY)) && prefs.showcollapse() ) {
     return(event_inside(_collapse_xywh) ? 1 : 0);
   } else {
     return(0);
@@ -1255,13 +1493,34 @@ void Fl_Tree_Item::hide_widgets() {
 }
 
 /// Open this item and all its children.
+/// If the item's children are created on demand, the tree's
+/// populate callback is invoked first.
+/// \see lazy_children(int), Fl_Tree::populate_callback()
 void Fl_Tree_Item::open() {
+  if ( _tree && is_flag(LAZY|POPULATED) ) _tree->lazy_open(this);
   set_flag(OPEN,1);
   // Tell children to show() their widgets
   for ( int t=0; t<_children.total(); t++ ) {
     _children[t]->show_widgets();
   }
   recalc_tree();                // may change tree geometry
+  if ( _tree && is_flag(POPULATED) ) _tree->lazy_trim(this);
+}
+
+/// Mark this item as having children that are created on demand.
+///
+/// When \p 'val' is 1, the item is closed and shows an 'open' icon even
+/// though it has no children yet. The first time it is opened, the
+/// tree's populate callback is invoked to add the children.
+/// When \p 'val' is 0, the item is a regular item again.
+///
+/// \see lazy_children(), Fl_Tree::populate_callback(), Fl_Tree::unload()
+/// \version 1.4.0
+///
+void Fl_Tree_Item::lazy_children(int val) {
+  if ( val ) set_flag(OPEN,0);
+  set_flag(LAZY,val);
+  recalc_tree();                // may change item's height (open icon)
 }
 
 /// Close this item and all its children.
@@ -1480,3 +1739,25 @@ int Fl_Tree_Item::visible_r() const {
 void Fl_Tree_Item::recalc_tree() {
   _tree->recalc_tree();
 }
+
+// Internal: Called when children were added to or removed from this item.
+//    Besides the tree geometry, this changes the selection counts of the
+//    parents, so the tree recounts them when it needs them again.
+//
+void Fl_Tree_Item::children_changed() {
+  _tree->recalc_tree();
+  _tree->_selcount_valid = 0;
+}
+
+// Internal: Called when this item's SELECTED flag changes by 'delta' (+1 or -1).
+//    Updates the selection counts of the item and its parents, if the tree
+//    the item belongs to has them up to date. See Fl_Tree::next_selected_item().
+//
+void Fl_Tree_Item::selection_changed(int delta) {
+  Fl_Tree_Item *top = this;
+  while ( top->_parent ) top = top->_parent;
+  Fl_Tree *tree = top->_tree;
+  if ( !tree || tree->_root != top || !tree->_selcount_valid ) return;
+  for ( Fl_Tree_Item *p = this; p; p = p->_parent )
+    p->_nselected += delta;
+}
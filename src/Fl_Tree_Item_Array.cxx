@@ -36,6 +36,9 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _size      = 0;
   _flags     = 0;
   _chunksize = new_chunksize;
+  _index      = 0;
+  _indexsize  = 0;
+  _indexcount = 0;
 }
 
 /// Destructor. Calls each item's destructor, destroys internal _items array.
@@ -50,6 +53,9 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
   _size      = o->_size;
   _chunksize = o->_chunksize;
   _flags     = o->_flags;
+  _index      = 0;                      // built again by find() if needed
+  _indexsize  = 0;
+  _indexcount = 0;
   for ( int t=0; t<o->_total; t++ ) {
     if ( _flags & MANAGE_ITEM ) {
       _items[t] = new Fl_Tree_Item(o->_items[t]);       // make new copy of item
@@ -79,6 +85,8 @@ void Fl_Tree_Item_Array::clear() {
     free((void*)_items); _items = 0;
   }
   _total = _size = 0;
+  if ( _index ) { free((void*)_index); _index = 0; }
+  _indexsize = _indexcount = 0;
 }
 
 // Internal: Enlarge the items array.
@@ -127,6 +135,7 @@ void Fl_Tree_Item_Array::insert(int pos, Fl_Tree_Item *new_item) {
   {
     _items[pos]->update_prev_next(pos); // adjust item's prev/next and its neighbors
   }
+  index_add(new_item);
 }
 
 /// Add an item* to the end of the array.
@@ -146,6 +155,7 @@ void Fl_Tree_Item_Array::add(Fl_Tree_Item *val) {
 ///
 void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
   if ( _items[index] ) {                        // delete if non-zero
+    index_remove(_items[index]);
     if ( _flags & MANAGE_ITEM )
       // Destroy old item
       delete _items[index];
@@ -156,6 +166,7 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
     // Restitch into linked list
     _items[index]->update_prev_next(index);
   }
+  index_add(newitem);
 }
 
 /// Remove the item at \param[in] index from the array.
@@ -164,6 +175,7 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
 ///
 void Fl_Tree_Item_Array::remove(int index) {
   if ( _items[index] ) {                        // delete if non-zero
+    index_remove(_items[index]);
     if ( _flags & MANAGE_ITEM )
       delete _items[index];
   }
@@ -250,6 +262,7 @@ int Fl_Tree_Item_Array::deparent(int pos) {
   Fl_Tree_Item *item = _items[pos];
   Fl_Tree_Item *prev = item->prev_sibling();
   Fl_Tree_Item *next = item->next_sibling();
+  index_remove(item);
   // Remove from parent's list of children
   _total -= 1;
   for ( int t=pos; t<_total; t++ )
@@ -278,5 +291,130 @@ int Fl_Tree_Item_Array::reparent(Fl_Tree_Item *item, Fl_Tree_Item* newparent, in
   // Attach to new parent and siblings
   _items[pos]->parent(newparent);       // reparent (update_prev_next() needs this)
   _items[pos]->update_prev_next(pos);   // find new siblings
+  index_add(item);
   return 0;
 }
+
+// Arrays with fewer items than this are searched linearly by find()
+#define INDEX_MIN_ITEMS 32
+
+// An entry of the label index: a label and how many items have it.
+//    Items with the same label share one entry, so adding many items with
+//    the same label does not make the probe runs longer. 'label' points to
+//    the label of one of these items; labels are shared by all items with
+//    the same text (see Fl_Tree_Item::label()), so it stays valid as long
+//    as 'count' is not zero.
+//
+struct Fl_Tree_Item_Array::Index_Entry {
+  const char *label;                    // 0 if the slot is empty
+  unsigned hash;                        // hash of label
+  int count;                            // #items with this label
+  Fl_Tree_Item *item;                   // the item if count is 1, or 0 if not known
+};
+
+static unsigned label_hash(const char *s) {
+  unsigned h = 2166136261U;             // FNV-1a
+  while ( *s ) { h ^= (unsigned char)*s++; h *= 16777619U; }
+  return h;
+}
+
+// Internal: Return the slot of label 'name' in the index, or the empty
+// slot where it would be added.
+int Fl_Tree_Item_Array::index_find(const char *name, unsigned hash) const {
+  unsigned mask = (unsigned)_indexsize - 1;
+  unsigned i = hash & mask;
+  while ( _index[i].label &&
+          ( _index[i].hash != hash || strcmp(_index[i].label, name) != 0 ) )
+    i = (i + 1) & mask;
+  return (int)i;
+}
+
+// Internal: (Re)build the label index with 'size' slots from the items.
+void Fl_Tree_Item_Array::index_build(int size) const {
+  if ( _index ) free((void*)_index);
+  _index = (Index_Entry*)calloc(size, sizeof(Index_Entry));
+  _indexsize = size;
+  _indexcount = 0;
+  for ( int t=0; t<_total; t++ )
+    ((Fl_Tree_Item_Array*)this)->index_add(_items[t]);
+}
+
+// Internal: Add an item that was just put into the array to the label index.
+//    Items without a label are not in the index.
+void Fl_Tree_Item_Array::index_add(Fl_Tree_Item *item) {
+  if ( !_index || !item || !item->label() ) return;
+  const char *name = item->label();
+  unsigned hash = label_hash(name);
+  Index_Entry *e = &_index[index_find(name, hash)];
+  if ( e->label ) {                             // more items with this label
+    e->count++;
+    e->item = 0;
+    return;
+  }
+  if ( 2 * (_indexcount + 1) > _indexsize ) {   // keep the table half empty
+    index_build(2 * _indexsize);                // (includes the new item)
+    return;
+  }
+  e->label = name;
+  e->hash  = hash;
+  e->count = 1;
+  e->item  = item;
+  _indexcount++;
+}
+
+// Internal: Remove an item from the label index, before it leaves the array
+// or its label changes. Returns 1 if the array has an index.
+int Fl_Tree_Item_Array::index_remove(Fl_Tree_Item *item) {
+  if ( !_index ) return 0;
+  if ( !item || !item->label() ) return 1;
+  const char *name = item->label();
+  unsigned i = (unsigned)index_find(name, label_hash(name));
+  Index_Entry *e = &_index[i];
+  if ( !e->label ) return 1;                    // (not in the index)
+  if ( --e->count > 0 ) {
+    e->item = 0;                                // found again by find()
+    return 1;
+  }
+  // Empty the slot, moving later entries of the same run back into the hole
+  e->label = 0;
+  _indexcount--;
+  unsigned mask = (unsigned)_indexsize - 1;
+  for ( unsigned j = (i + 1) & mask; _index[j].label; j = (j + 1) & mask ) {
+    unsigned k = _index[j].hash & mask;
+    if ( i <= j ? (i < k && k <= j) : (i < k || k <= j) ) continue;
+    _index[i] = _index[j];
+    _index[j].label = 0;
+    i = j;
+  }
+  return 1;
+}
+
+/// Find the first item in the array with the label \p 'name'.
+///
+///     Large arrays are searched with a hash table of the labels,
+///     which is built on first use and then kept up to date as
+///     items are added, removed or relabeled. Labels that several
+///     items have are searched in order.
+///
+///     \returns the item, or 0 if not found.
+///
+Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *name) const {
+  if ( !name ) return(0);
+  if ( !_index && _total >= INDEX_MIN_ITEMS ) {
+    int size = 64;
+    while ( size < 2 * _total ) size *= 2;
+    index_build(size);
+  }
+  Index_Entry *e = 0;
+  if ( _index ) {
+    e = &_index[index_find(name, label_hash(name))];
+    if ( !e->label ) return(0);                 // no item has this label
+    if ( e->item ) return(e->item);
+  }
+  for ( int t=0; t<_total; t++ )
+    if ( _items[t] && _items[t]->label() && strcmp(_items[t]->label(), name) == 0 ) {
+      if ( e && e->count == 1 ) e->item = _items[t];  // remember the only one
+      return(_items[t]);
+    }
+  return(0);
+}
@@ -457,6 +457,30 @@ void Fl_Window::wait_for_expose() {
 }
 
 
+/**
+  Sets the minimum time between two redraws of this window.
+
+  Damage that arrives before \p seconds have passed since the last redraw
+  is accumulated and the window is redrawn once, at the next multiple of
+  \p seconds on a monotonic clock. Use this for windows showing values
+  that change faster than anybody can read them. Other windows are not
+  held back. The default, 0, redraws the window whenever Fl::flush() runs.
+
+  \see Fl::max_fps(double)
+*/
+void Fl_Window::present_interval(double seconds) {
+  pWindowDriver->present_interval = seconds > 0 ? seconds : 0;
+  pWindowDriver->next_present = 0;
+}
+
+/** Returns the minimum time between two redraws of this window.
+  \see present_interval(double)
+*/
+double Fl_Window::present_interval() const {
+  return pWindowDriver->present_interval;
+}
+
+
 int Fl_Window::decorated_w() const
 {
   return pWindowDriver->decorated_w();
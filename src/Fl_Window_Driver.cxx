@@ -42,6 +42,9 @@ pWindow(win)
   shape_data_ = NULL;
   wait_for_expose_value = 0;
   other_xid = 0;
+  damage_rects_count = 0;
+  present_interval = 0;
+  next_present = 0;
 }
 
 
@@ -49,6 +52,50 @@ Fl_Window_Driver::~Fl_Window_Driver()
 {
 }
 
+// area of the bounding box of two rectangles
+static long bbox_area(const Fl_Rect &a, const Fl_Rect &b) {
+  int X = a.x() < b.x() ? a.x() : b.x(), R = a.r() > b.r() ? a.r() : b.r();
+  int Y = a.y() < b.y() ? a.y() : b.y(), B = a.b() > b.b() ? a.b() : b.b();
+  return long(R - X) * (B - Y);
+}
+
+/**
+ Adds a rectangle to the list of damaged rectangles of the window.
+
+ The list is kept disjoint: a rectangle overlapping others is merged with
+ them into their bounding box. When the list is full the new rectangle is
+ merged with the one whose bounding box wastes the least area.
+ \see Fl_Widget::damage(uchar, int, int, int, int)
+ */
+void Fl_Window_Driver::add_damage_rect(int X, int Y, int W, int H)
+{
+  Fl_Rect r(X, Y, W, H);
+  for (;;) {
+    int i, m = -1;
+    for (i = 0; i < damage_rects_count; i++) {
+      const Fl_Rect &d = damage_rects[i];
+      if (d.x() < r.r() && r.x() < d.r() && d.y() < r.b() && r.y() < d.b()) { m = i; break; }
+    }
+    if (m < 0) {
+      if (damage_rects_count < DAMAGE_RECTS_MAX) break;
+      long best = 0;
+      for (i = 0; i < damage_rects_count; i++) {
+        const Fl_Rect &d = damage_rects[i];
+        long waste = bbox_area(r, d) - long(d.w()) * d.h();
+        if (m < 0 || waste < best) { m = i; best = waste; }
+      }
+    }
+    // merge with damage_rects[m] and check the result again
+    const Fl_Rect &d = damage_rects[m];
+    int R = r.r() > d.r() ? r.r() : d.r(), B = r.b() > d.b() ? r.b() : d.b();
+    if (d.x() < r.x()) r.x(d.x());
+    if (d.y() < r.y()) r.y(d.y());
+    r.w(R - r.x()); r.h(B - r.y());
+    damage_rects[m] = damage_rects[--damage_rects_count];
+  }
+  damage_rects[damage_rects_count++] = r;
+}
+
 int Fl_Window_Driver::minw() {return pWindow->minw;}
 int Fl_Window_Driver::minh() {return pWindow->minh;}
 int Fl_Window_Driver::maxw() {return pWindow->maxw;}
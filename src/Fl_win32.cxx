@@ -1259,6 +1259,7 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPar
         if (!i->region && window->damage()) {
           // Redraw the whole window...
           i->region = CreateRectRgn(0, 0, window->w(), window->h());
+          Fl_Window_Driver::driver(window)->damage_rects_count = 0;
           redraw_whole_window = true;
         }
 
@@ -1281,6 +1282,7 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPar
           r_box.top = LONG(r_box.top / scale);
           r_box.bottom = LONG(r_box.bottom / scale);
           Fl_Region R3 = CreateRectRgn(r_box.left, r_box.top, r_box.right + 1, r_box.bottom + 1);
+          Fl_Window_Driver::driver(window)->damage_rects_count = 0;
           if (!i->region) i->region = R3;
           else {
             CombineRgn(i->region, i->region, R3, RGN_OR);
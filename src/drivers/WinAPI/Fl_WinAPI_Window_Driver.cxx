@@ -304,9 +304,14 @@ void Fl_WinAPI_Window_Driver::flush_double()
   Fl_X *i = Fl_X::i(pWindow);
   if (!i) return; // window not yet created
 
+  // copy only the damaged rectangles unless the whole window must be copied;
+  // areas exposed by WM_PAINT are not in the list
+  int nrects = (i->region && !(pWindow->damage() & FL_DAMAGE_EXPOSE)) ? damage_rects_count : 0;
+  damage_rects_count = 0;
   if (!other_xid) {
     other_xid = fl_create_offscreen(w(), h());
     pWindow->clear_damage(FL_DAMAGE_ALL);
+    nrects = 0;
   }
   if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
     fl_clip_region(i->region); i->region = 0;
@@ -332,9 +337,17 @@ void Fl_WinAPI_Window_Driver::flush_double()
     fl_graphics_driver->gc(sgc);
 #endif
   }
-  int X = 0, Y = 0, W = 0, H = 0;
-  fl_clip_box(0, 0, w(), h(), X, Y, W, H);
-  if (other_xid) fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  if (!other_xid) return;
+  if (nrects) {
+    for (int n = 0; n < nrects; n++) {
+      const Fl_Rect &r = damage_rects[n];
+      fl_copy_offscreen(r.x(), r.y(), r.w(), r.h(), other_xid, r.x(), r.y());
+    }
+  } else {
+    int X = 0, Y = 0, W = 0, H = 0;
+    fl_clip_box(0, 0, w(), h(), X, Y, W, H);
+    fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  }
 }
 
 
@@ -220,9 +220,13 @@ void Fl_X11_Window_Driver::flush_double(int erase_overlay)
 {
   pWindow->make_current(); // make sure fl_gc is non-zero
   Fl_X *i = Fl_X::i(pWindow);
+  // copy only the damaged rectangles unless the whole window must be copied
+  int nrects = (i->region && !erase_overlay) ? damage_rects_count : 0;
+  damage_rects_count = 0;
   if (!other_xid) {
       other_xid = fl_create_offscreen(w(), h());
     pWindow->clear_damage(FL_DAMAGE_ALL);
+    nrects = 0;
   }
     if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
       fl_clip_region(i->region); i->region = 0;
@@ -231,9 +235,17 @@ void Fl_X11_Window_Driver::flush_double(int erase_overlay)
       fl_window = i->xid;
     }
   if (erase_overlay) fl_clip_region(0);
-  int X = 0, Y = 0, W = 0, H = 0;
-  fl_clip_box(0, 0, w(), h(), X, Y, W, H);
-  if (other_xid) fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  if (!other_xid) return;
+  if (nrects) {
+    for (int n = 0; n < nrects; n++) {
+      const Fl_Rect &r = damage_rects[n];
+      fl_copy_offscreen(r.x(), r.y(), r.w(), r.h(), other_xid, r.x(), r.y());
+    }
+  } else {
+    int X = 0, Y = 0, W = 0, H = 0;
+    fl_clip_box(0, 0, w(), h(), X, Y, W, H);
+    fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  }
 }
 
 
@@ -0,0 +1,240 @@
+//
+// Cache of drawn box types for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Scheme box types like the plastic and gleam boxes draw their gradients
+// with one color computation and one line per row. fl_draw_cached_box()
+// draws such a box once into an offscreen buffer and copies it from there
+// on later draws with the same size, color and state.
+//
+// The copy must not touch pixels that the box function leaves alone
+// (e.g. the corners of the box), so the box is drawn twice, on a black
+// and on a white background, and only the rectangles of pixels that are
+// the same in both are copied. Some box functions draw a pixel or two
+// outside of their bounds (e.g. for very small boxes), so the offscreen
+// buffer has a margin of MARGIN pixels around the box.
+
+#include <FL/Fl.H>
+#include <FL/platform.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Device.H>
+#include <FL/Fl_Graphics_Driver.H>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RECTS 16    // boxes needing more rectangles are drawn directly
+#define NBUCKETS 256
+#define MARGIN 2       // pixels around the box in the offscreen buffer
+
+struct Cached_Box {
+  Fl_Box_Draw_F *f;
+  int w, h;
+  Fl_Color c;
+  unsigned rgb, gray;   // palette entries of c and FL_GRAY
+  float scale;
+  int active;
+  Fl_Offscreen offscreen;
+  int nrects;           // -1 if the box cannot be cached
+  int rects[MAX_RECTS][4];
+  long bytes;
+  Cached_Box *hnext;            // next in hash bucket
+  Cached_Box *prev, *next;      // least recently used first
+};
+
+static Cached_Box *buckets[NBUCKETS];
+static Cached_Box *lru_first, *lru_last;
+static long cache_bytes = 0, cache_max = 0;
+
+static unsigned hash(Fl_Box_Draw_F *f, int w, int h, Fl_Color c) {
+  unsigned v = (unsigned)(((fl_uintptr_t)f) >> 4);
+  v = v * 31 + w;
+  v = v * 31 + h;
+  v = v * 31 + c;
+  return (v ^ (v >> 8)) % NBUCKETS;
+}
+
+static void lru_unlink(Cached_Box *e) {
+  if (e->prev) e->prev->next = e->next; else lru_first = e->next;
+  if (e->next) e->next->prev = e->prev; else lru_last = e->prev;
+  e->prev = e->next = 0;
+}
+
+static void lru_append(Cached_Box *e) {
+  e->prev = lru_last;
+  e->next = 0;
+  if (lru_last) lru_last->next = e; else lru_first = e;
+  lru_last = e;
+}
+
+static void remove_box(Cached_Box *e) {
+  Cached_Box **p = &buckets[hash(e->f, e->w, e->h, e->c)];
+  while (*p != e) p = &(*p)->hnext;
+  *p = e->hnext;
+  lru_unlink(e);
+  if (e->offscreen) fl_delete_offscreen(e->offscreen);
+  cache_bytes -= e->bytes;
+  free(e);
+}
+
+// removes the least recently used boxes until the cache holds at most max bytes
+static void trim(long max) {
+  while (lru_first && cache_bytes > max) remove_box(lru_first);
+}
+
+// Finds the rectangles of pixels drawn by the box function: those that
+// are the same on a black (a) and on a white (b) background.
+static int find_rects(const uchar *a, const uchar *b, int w, int h, int rects[][4]) {
+  int n = 0, prev = 0;  // rectangles that ended on the previous row
+  for (int y = 0; y < h; y++) {
+    int spans[MAX_RECTS][2], ns = 0;
+    const uchar *pa = a + y * w * 3, *pb = b + y * w * 3;
+    for (int x = 0; x < w; ) {
+      while (x < w && memcmp(pa + 3 * x, pb + 3 * x, 3)) x++;
+      if (x >= w) break;
+      int x0 = x;
+      while (x < w && !memcmp(pa + 3 * x, pb + 3 * x, 3)) x++;
+      if (ns == MAX_RECTS) return -1;
+      spans[ns][0] = x0; spans[ns][1] = x - x0; ns++;
+    }
+    int same = (ns == prev && ns > 0);
+    for (int i = 0; same && i < ns; i++)
+      same = (rects[n - ns + i][0] == spans[i][0] && rects[n - ns + i][2] == spans[i][1]);
+    if (same) {
+      for (int i = 0; i < ns; i++) rects[n - ns + i][3]++;
+    } else {
+      if (n + ns > MAX_RECTS) return -1;
+      for (int i = 0; i < ns; i++, n++) {
+        rects[n][0] = spans[i][0]; rects[n][1] = y;
+        rects[n][2] = spans[i][1]; rects[n][3] = 1;
+      }
+    }
+    prev = ns;
+  }
+  return n;
+}
+
+// returns non-zero if the box drew on the outer border of the buffer,
+// which means it may also have drawn beyond it
+static int touches_border(const uchar *a, const uchar *b, int w, int h) {
+  for (int y = 0; y < h; y++) {
+    int step = (y == 0 || y == h - 1) ? 1 : w - 1;
+    for (int x = 0; x < w; x += step) {
+      int i = 3 * (y * w + x);
+      if (!memcmp(a + i, b + i, 3)) return 1;
+    }
+  }
+  return 0;
+}
+
+// draws the box into a new offscreen buffer of entry e
+static void render(Cached_Box *e) {
+  int w = e->w + 2 * MARGIN, h = e->h + 2 * MARGIN;
+  e->nrects = -1;
+  e->bytes = sizeof(Cached_Box);
+  e->offscreen = fl_create_offscreen(w, h);
+  if (!e->offscreen) return;
+  fl_begin_offscreen(e->offscreen);
+  fl_color(0, 0, 0);
+  fl_rectf(0, 0, w, h);
+  e->f(MARGIN, MARGIN, e->w, e->h, e->c);
+  uchar *a = fl_read_image(0, 0, 0, w, h);
+  fl_color(255, 255, 255);
+  fl_rectf(0, 0, w, h);
+  e->f(MARGIN, MARGIN, e->w, e->h, e->c);
+  uchar *b = fl_read_image(0, 0, 0, w, h);
+  fl_end_offscreen();
+  if (a && b && !touches_border(a, b, w, h))
+    e->nrects = find_rects(a, b, w, h, e->rects);
+  delete[] a;
+  delete[] b;
+  if (e->nrects < 0) {
+    fl_delete_offscreen(e->offscreen);
+    e->offscreen = 0;
+  } else {
+    e->bytes += long(w * e->scale) * long(h * e->scale) * 4;
+  }
+}
+
+/*
+ Draws box function f from the cache, adding it to the cache if needed.
+ Returns 0 if the box must be drawn directly, because the cache is off,
+ we are not drawing to the display, or the scale is fractional.
+ */
+int fl_draw_cached_box(Fl_Box_Draw_F *f, int x, int y, int w, int h, Fl_Color c) {
+  if (!cache_max || w <= 0 || h <= 0) return 0;
+  Fl_Surface_Device *display = Fl_Display_Device::display_device();
+  if (Fl_Surface_Device::surface() != display || fl_graphics_driver != display->driver())
+    return 0;
+  float s = fl_graphics_driver->scale();
+  if (s != int(s)) return 0; // exact rectangles need whole pixels
+  if (long(w * s) * long(h * s) * 4 > cache_max / 4) return 0;
+  unsigned rgb = Fl::get_color(c), gray = Fl::get_color(FL_GRAY);
+  int active = Fl::draw_box_active();
+  Cached_Box **bucket = &buckets[hash(f, w, h, c)], *e;
+  for (e = *bucket; e; e = e->hnext) {
+    if (e->f == f && e->w == w && e->h == h && e->c == c && e->active == active &&
+        e->scale == s && e->rgb == rgb && e->gray == gray) break;
+  }
+  if (!e) {
+    e = (Cached_Box*)calloc(1, sizeof(Cached_Box));
+    if (!e) return 0;
+    e->f = f; e->w = w; e->h = h; e->c = c;
+    e->rgb = rgb; e->gray = gray; e->scale = s; e->active = active;
+    render(e);
+    cache_bytes += e->bytes;
+    e->hnext = *bucket;
+    *bucket = e;
+    lru_append(e);
+  } else {
+    lru_unlink(e);
+    lru_append(e);
+  }
+  if (e->nrects < 0) return 0;
+  for (int i = 0; i < e->nrects; i++) {
+    const int *r = e->rects[i];
+    fl_copy_offscreen(x - MARGIN + r[0], y - MARGIN + r[1], r[2], r[3],
+                      e->offscreen, r[0], r[1]);
+  }
+  trim(cache_max);
+  return 1;
+}
+
+/**
+  Sets the size of the cache of drawn box types in kilobytes, 0 to disable
+  it (the default).
+
+  With the cache enabled, the plastic and gleam box types are drawn into
+  offscreen buffers, and later draws of a box with the same size, color
+  and active state copy the buffer to the screen instead of computing the
+  gradient again. When the cache is full, the least recently drawn boxes
+  are removed. A cached box uses about 4 bytes per pixel, and boxes bigger
+  than a quarter of the cache are not cached.
+
+  The cache is only used when drawing to the display at a whole-number
+  scaling factor.
+  \since 1.4.0
+*/
+void Fl::box_cache_size(int kbytes) {
+  cache_max = kbytes > 0 ? long(kbytes) * 1024 : 0;
+  trim(cache_max);
+}
+
+/** Returns the size of the cache of drawn box types in kilobytes.
+  \see box_cache_size(int)
+  \since 1.4.0
+*/
+int Fl::box_cache_size() {
+  return int(cache_max / 1024);
+}
@@ -24,6 +24,7 @@
 #include <FL/fl_utf8.h>
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
+#include <FL/Fl_Graphics_Driver.H>
 #include <FL/Fl_Image.H>
 #include <FL/platform.H>        // fl_open_display()
 
@@ -125,6 +126,217 @@ fl_expand_text(const char* from, char* buf, int maxbuf, double maxw, int& n,
   return expand_text_(from,  buf, maxbuf, maxw,  n, width,  wrap,  draw_symbols);
 }
 
+// Cache of text layouts.
+//
+// Labels of static widgets are laid out again on every redraw and every
+// measure_label(). With Fl::label_cache_size() set, the lines computed by
+// expand_text_() and their widths are kept, keyed by the string contents,
+// the font and the wrap width, and reused until the least recently used
+// layouts are removed to make room for new ones. Without the cache, one
+// static layout is reused, so that drawing a label does not allocate memory.
+
+struct Layout_Line {
+  int start, len;       // expanded text of the line in Text_Layout::text
+  double width;
+  int underline;        // offset of the shortcut underline, or -1
+  double underline_x;   // width of the text before the underline
+  int stop;             // fl_draw() stops after this line
+};
+
+struct Text_Layout {
+  unsigned hash;
+  int len;              // the key: length and copy of the string...
+  char *str;
+  Fl_Graphics_Driver *driver; // ...and what the widths depend on
+  Fl_Font_Descriptor *fd;
+  Fl_Font font;
+  Fl_Fontsize size;
+  float scale;
+  int wrap, maxw;       // maxw is 0 if not wrapped
+  int draw_symbols, shortcut;
+  int nlines, alines;    // used and allocated lines
+  Layout_Line *lines;
+  char *text;
+  int atext;            // allocated size of text
+  long bytes;
+  int busy;             // in use by fl_draw() or fl_measure()
+  int cached;
+  Text_Layout *hnext;           // next in hash bucket
+  Text_Layout *prev, *next;     // least recently used first
+};
+
+static Text_Layout **layout_buckets;   // hash table, sized by Fl::label_cache_size()
+static unsigned layout_nbuckets = 0;    // a power of 2
+static Text_Layout *layout_first, *layout_last;
+static long layout_bytes = 0, layout_max = 0;
+static Text_Layout scratch_layout;      // used when the layout is not cached
+
+static void free_layout(Text_Layout *l) {
+  free(l->str);
+  free(l->lines);
+  free(l->text);
+  free(l);
+}
+
+static void remove_layout(Text_Layout *l) {
+  Text_Layout **p = &layout_buckets[l->hash & (layout_nbuckets - 1)];
+  while (*p != l) p = &(*p)->hnext;
+  *p = l->hnext;
+  if (l->prev) l->prev->next = l->next; else layout_first = l->next;
+  if (l->next) l->next->prev = l->prev; else layout_last = l->prev;
+  layout_bytes -= l->bytes;
+  free_layout(l);
+}
+
+// removes the least recently used layouts until the cache holds at most max bytes
+static void trim_layouts(long max) {
+  Text_Layout *l = layout_first;
+  while (l && layout_bytes > max) {
+    Text_Layout *next = l->next;
+    if (!l->busy) remove_layout(l);
+    l = next;
+  }
+}
+
+// resizes the hash table to about one bucket per 256 bytes of cache
+static void size_layout_buckets() {
+  unsigned n = 0;
+  if (layout_max) {
+    n = 64;
+    while (n < (unsigned long)layout_max / 256 && n < (1U << 20)) n *= 2;
+  } else if (layout_first) {
+    return; // keep the table for layouts that are still in use
+  }
+  if (n == layout_nbuckets) return;
+  Text_Layout **b = 0;
+  if (n) {
+    b = (Text_Layout**)calloc(n, sizeof(Text_Layout*));
+    if (!b) return;
+  }
+  for (Text_Layout *l = layout_first; l; l = l->next) {
+    Text_Layout **bucket = &b[l->hash & (n - 1)];
+    l->hnext = *bucket;
+    *bucket = l;
+  }
+  free(layout_buckets);
+  layout_buckets = b;
+  layout_nbuckets = n;
+}
+
+// breaks str into lines like fl_draw() and fl_measure() do
+static int compute_layout(Text_Layout *l, const char *str) {
+  char *linebuf = NULL;
+  int buflen, ntext = 0;
+  double width;
+  const char *p, *e;
+  l->nlines = 0;
+  for (p = str;;) {
+    e = expand_text_(p, linebuf, 0, l->maxw, buflen, width, l->wrap, l->draw_symbols);
+    if (l->nlines >= l->alines) {
+      int alines = l->alines ? 2 * l->alines : 4;
+      Layout_Line *n = (Layout_Line*)realloc(l->lines, alines * sizeof(Layout_Line));
+      if (!n) return 0;
+      l->lines = n;
+      l->alines = alines;
+    }
+    if (ntext + buflen + 1 > l->atext) {
+      int atext = ntext + buflen + 1 + l->atext;
+      char *n = (char*)realloc(l->text, atext);
+      if (!n) return 0;
+      l->text = n;
+      l->atext = atext;
+    }
+    Layout_Line &line = l->lines[l->nlines++];
+    line.start = ntext;
+    line.len = buflen;
+    line.width = width;
+    line.underline = -1;
+    line.underline_x = 0;
+    if (underline_at && underline_at >= linebuf && underline_at < (linebuf + buflen)) {
+      line.underline = (int) (underline_at - linebuf);
+      line.underline_x = fl_width(linebuf, line.underline);
+    }
+    line.stop = (!*e || (*e == '@' && e[1] != '@'));
+    memcpy(l->text + ntext, linebuf, buflen + 1);
+    ntext += buflen + 1;
+    if (!*e || (*e == '@' && e[1] != '@' && l->draw_symbols)) break;
+    p = e;
+  }
+  l->bytes = sizeof(Text_Layout) + l->len + 1 + l->alines * sizeof(Layout_Line) + l->atext;
+  return 1;
+}
+
+/* Returns the layout of str, from the cache if possible. It must be passed
+ to release_layout() when done. Returns NULL if out of memory.
+ */
+static Text_Layout *get_layout(const char *str, int maxw, int wrap, int draw_symbols) {
+  unsigned hash = 2166136261U;
+  const char *p;
+  for (p = str; *p; p++) hash = (hash ^ (uchar)*p) * 16777619U;
+  int len = (int) (p - str);
+  Fl_Graphics_Driver *driver = fl_graphics_driver;
+  Fl_Font_Descriptor *fd = driver->font_descriptor();
+  Fl_Font font = fl_font();
+  Fl_Fontsize size = fl_size();
+  float scale = driver->scale();
+  wrap = wrap != 0;
+  if (!wrap) maxw = 0;
+  int shortcut = fl_draw_shortcut;
+  hash = hash * 31 + font;
+  hash = hash * 31 + size;
+  hash = hash * 31 + maxw * 2 + wrap;
+  Text_Layout *l;
+  if (layout_max && layout_nbuckets) {
+    for (l = layout_buckets[hash & (layout_nbuckets - 1)]; l; l = l->hnext) {
+      if (l->hash == hash && l->len == len && l->driver == driver && l->fd == fd &&
+          l->font == font && l->size == size && l->scale == scale && l->wrap == wrap && l->maxw == maxw &&
+          l->draw_symbols == draw_symbols && l->shortcut == shortcut &&
+          !memcmp(l->str, str, len)) {
+        if (l != layout_last) { // move to the end of the LRU list
+          if (l->prev) l->prev->next = l->next; else layout_first = l->next;
+          l->next->prev = l->prev;
+          l->prev = layout_last;
+          l->next = 0;
+          layout_last->next = l;
+          layout_last = l;
+        }
+        l->busy++;
+        return l;
+      }
+    }
+  }
+  if (!layout_max && !scratch_layout.busy)
+    l = &scratch_layout;
+  else if (!(l = (Text_Layout*)calloc(1, sizeof(Text_Layout))))
+    return 0;
+  l->hash = hash; l->len = len;
+  l->driver = driver; l->fd = fd; l->font = font; l->size = size; l->scale = scale;
+  l->wrap = wrap; l->maxw = maxw; l->draw_symbols = draw_symbols; l->shortcut = shortcut;
+  if (!compute_layout(l, str)) {
+    if (l != &scratch_layout) free_layout(l);
+    return 0;
+  }
+  l->busy = 1;
+  if (layout_max && layout_nbuckets && l->bytes <= layout_max / 4 && (l->str = (char*)malloc(len + 1)) != 0) {
+    memcpy(l->str, str, len + 1);
+    l->cached = 1;
+    Text_Layout **bucket = &layout_buckets[hash & (layout_nbuckets - 1)];
+    l->hnext = *bucket;
+    *bucket = l;
+    l->prev = layout_last;
+    if (layout_last) layout_last->next = l; else layout_first = l;
+    layout_last = l;
+    layout_bytes += l->bytes;
+    trim_layouts(layout_max);
+  }
+  return l;
+}
+
+static void release_layout(Text_Layout *l) {
+  l->busy--;
+  if (!l->cached && l != &scratch_layout) free_layout(l);
+}
+
 /**
   The same as fl_draw(const char*,int,int,int,int,Fl_Align,Fl_Image*,int) with
   the addition of the \p callthis parameter, which is a pointer to a text drawing
@@ -137,16 +349,13 @@ void fl_draw(
     void (*callthis)(const char*,int,int,int),
     Fl_Image* img, int draw_symbols)
 {
-  char *linebuf = NULL;
   const char* p;
-  const char* e;
-  int buflen;
   char symbol[2][255], *symptr;
   int symwidth[2], symoffset, symtotal, imgtotal;
 
-  // count how many lines and put the last one into the buffer:
+  // count how many lines:
   int lines;
-  double width;
+  Text_Layout *layout = 0;
 
   // if the image is set as a backdrop, ignore it here
   if (img && (align & FL_ALIGN_IMAGE_BACKDROP)) img = 0;
@@ -180,15 +389,11 @@ void fl_draw(
   int strw = 0;
   int strh;
 
-  if (str) {
-    for (p = str, lines=0; p;) {
-      e = expand_text_(p, linebuf, 0, w - symtotal - imgtotal, buflen, width,
-                         align&FL_ALIGN_WRAP, draw_symbols);
-      if (strw<width) strw = (int)width;
-      lines++;
-      if (!*e || (*e == '@' && e[1] != '@' && draw_symbols)) break;
-      p = e;
-    }
+  if (str) layout = get_layout(str, w - symtotal - imgtotal, align&FL_ALIGN_WRAP, draw_symbols);
+  if (layout) {
+    lines = layout->nlines;
+    for (int i = 0; i < lines; i++)
+      if (strw < layout->lines[i].width) strw = (int)layout->lines[i].width;
   } else lines = 0;
 
   if ((symwidth[0] || symwidth[1]) && lines) {
@@ -196,6 +401,12 @@ void fl_draw(
     if (symwidth[1]) symwidth[1] = lines * fl_height();
   }
 
+  // the lines are drawn wrapped to the width left next to the resized symbols
+  if (lines > 1 && (align & FL_ALIGN_WRAP) && symwidth[0] + symwidth[1] != symtotal) {
+    release_layout(layout); // only the line count was needed
+    layout = get_layout(str, w - symwidth[0] - symwidth[1] - imgtotal, 1, draw_symbols);
+  }
+
   symtotal = symwidth[0] + symwidth[1];
   strh = lines * fl_height();
 
@@ -246,12 +457,11 @@ void fl_draw(
   }
 
   // now draw all the lines:
-  if (str) {
+  if (layout) {
     int desc = fl_descent();
-    for (p=str; ; ypos += height) {
-      if (lines>1) e = expand_text_(p, linebuf, 0, w - symtotal - imgtotal, buflen,
-                                width, align&FL_ALIGN_WRAP, draw_symbols);
-      else e = "";
+    for (int i = 0; ; i++, ypos += height) {
+      const Layout_Line &line = layout->lines[i];
+      double width = line.width;
 
       if (width > symoffset) symoffset = (int)(width + 0.5);
 
@@ -259,14 +469,14 @@ void fl_draw(
       else if (align & FL_ALIGN_RIGHT) xpos = x + w - (int)(width + .5) - symwidth[1] - imgw[1];
       else xpos = x + (w - (int)(width + .5) - symtotal - imgw[0] - imgw[1]) / 2 + symwidth[0] + imgw[0];
 
-      callthis(linebuf,buflen,xpos,ypos-desc);
+      callthis(layout->text + line.start, line.len, xpos, ypos-desc);
 
-      if (underline_at && underline_at >= linebuf && underline_at < (linebuf + buflen))
-        callthis("_",1,xpos+int(fl_width(linebuf,(int) (underline_at-linebuf))),ypos-desc);
+      if (line.underline >= 0)
+        callthis("_",1,xpos+int(line.underline_x),ypos-desc);
 
-      if (!*e || (*e == '@' && e[1] != '@')) break;
-      p = e;
+      if (lines == 1 || line.stop) break;
     }
+    release_layout(layout);
   }
 
   // draw the image if the "text over image" alignment flag is set...
@@ -368,12 +578,8 @@ void fl_draw(
 void fl_measure(const char* str, int& w, int& h, int draw_symbols) {
   if (!str || !*str) {w = 0; h = 0; return;}
   h = fl_height();
-  char *linebuf = NULL;
   const char* p;
-  const char* e;
-  int buflen;
-  int lines;
-  double width=0;
+  int lines = 0;
   int W = 0;
   int symwidth[2], symtotal;
 
@@ -397,14 +603,12 @@ void fl_measure(const char* str, int& w, int& h, int draw_symbols) {
 
   symtotal = symwidth[0] + symwidth[1];
 
-  for (p = str, lines=0; p;) {
-//    e = expand(p, linebuf, w - symtotal, buflen, width, w != 0, draw_symbols);
-    e = expand_text_(p, linebuf, 0, w - symtotal, buflen, width,
-                        w != 0, draw_symbols);
-    if ((int)ceil(width) > W) W = (int)ceil(width);
-    lines++;
-    if (!*e || (*e == '@' && e[1] != '@' && draw_symbols)) break;
-    p = e;
+  Text_Layout *layout = get_layout(str, w - symtotal, w != 0, draw_symbols);
+  if (layout) {
+    lines = layout->nlines;
+    for (int i = 0; i < lines; i++)
+      if ((int)ceil(layout->lines[i].width) > W) W = (int)ceil(layout->lines[i].width);
+    release_layout(layout);
   }
 
   if ((symwidth[0] || symwidth[1]) && lines) {
@@ -418,6 +622,35 @@ void fl_measure(const char* str, int& w, int& h, int draw_symbols) {
   h = lines*h;
 }
 
+/**
+  Sets the size of the cache of text layouts in kilobytes, 0 to disable
+  it (the default).
+
+  With the cache enabled, fl_draw(const char*,int,int,int,int,Fl_Align,Fl_Image*,int)
+  and fl_measure() keep the line breaks and line widths they compute for
+  a string, and reuse them when the same string is drawn or measured again
+  with the same font, size and wrap width. This saves the text width
+  computations of static labels on every redraw. When the cache is full,
+  the least recently used layouts are removed.
+
+  The string contents are part of the key, so labels that change are
+  simply laid out again.
+  \since 1.4.0
+*/
+void Fl::label_cache_size(int kbytes) {
+  layout_max = kbytes > 0 ? long(kbytes) * 1024 : 0;
+  trim_layouts(layout_max);
+  size_layout_buckets();
+}
+
+/** Returns the size of the cache of text layouts in kilobytes.
+  \see label_cache_size(int)
+  \since 1.4.0
+*/
+int Fl::label_cache_size() {
+  return int(layout_max / 1024);
+}
+
 /**
   Sets the current font, which is then used in various drawing routines.
   You may call this outside a draw context if necessary to measure text,
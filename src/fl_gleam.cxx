@@ -164,16 +164,36 @@ static void thin_down_box(int x, int y, int w, int h, Fl_Color c) {
   frame_rect_down(x, y, w, h, c, fl_color_average(c, FL_BLACK, .45f), .35f, 0.85f);
 }
 
+// The boxes are drawn from the box cache if possible, see Fl::box_cache_size().
+
+extern int fl_draw_cached_box(Fl_Box_Draw_F*, int, int, int, int, Fl_Color);
+
+static void cached_up_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(up_box, x, y, w, h, c)) up_box(x, y, w, h, c);
+}
+
+static void cached_thin_up_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(thin_up_box, x, y, w, h, c)) thin_up_box(x, y, w, h, c);
+}
+
+static void cached_down_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(down_box, x, y, w, h, c)) down_box(x, y, w, h, c);
+}
+
+static void cached_thin_down_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(thin_down_box, x, y, w, h, c)) thin_down_box(x, y, w, h, c);
+}
+
 extern void fl_internal_boxtype(Fl_Boxtype, Fl_Box_Draw_F*);
 
 Fl_Boxtype fl_define_FL_GLEAM_UP_BOX() {
-  fl_internal_boxtype(_FL_GLEAM_UP_BOX, up_box);
-  fl_internal_boxtype(_FL_GLEAM_DOWN_BOX, down_box);
+  fl_internal_boxtype(_FL_GLEAM_UP_BOX, cached_up_box);
+  fl_internal_boxtype(_FL_GLEAM_DOWN_BOX, cached_down_box);
   fl_internal_boxtype(_FL_GLEAM_UP_FRAME, up_frame);
   fl_internal_boxtype(_FL_GLEAM_DOWN_FRAME, down_frame);
-  fl_internal_boxtype(_FL_GLEAM_THIN_UP_BOX, thin_up_box);
-  fl_internal_boxtype(_FL_GLEAM_THIN_DOWN_BOX, thin_down_box);
-  fl_internal_boxtype(_FL_GLEAM_ROUND_UP_BOX, up_box);
-  fl_internal_boxtype(_FL_GLEAM_ROUND_DOWN_BOX, down_box);
+  fl_internal_boxtype(_FL_GLEAM_THIN_UP_BOX, cached_thin_up_box);
+  fl_internal_boxtype(_FL_GLEAM_THIN_DOWN_BOX, cached_thin_down_box);
+  fl_internal_boxtype(_FL_GLEAM_ROUND_UP_BOX, cached_up_box);
+  fl_internal_boxtype(_FL_GLEAM_ROUND_DOWN_BOX, cached_down_box);
   return _FL_GLEAM_UP_BOX;
 }
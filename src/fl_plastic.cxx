@@ -348,16 +348,36 @@ static void down_round(int x, int y, int w, int h, Fl_Color c) {
 }
 
 
+extern int fl_draw_cached_box(Fl_Box_Draw_F*, int, int, int, int, Fl_Color);
+
+// The rectangular boxes are drawn from the box cache if possible,
+// see Fl::box_cache_size().
+
+static void cached_up_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(up_box, x, y, w, h, c)) up_box(x, y, w, h, c);
+}
+
+
+static void cached_down_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(down_box, x, y, w, h, c)) down_box(x, y, w, h, c);
+}
+
+
+static void cached_thin_up_box(int x, int y, int w, int h, Fl_Color c) {
+  if (!fl_draw_cached_box(thin_up_box, x, y, w, h, c)) thin_up_box(x, y, w, h, c);
+}
+
+
 extern void fl_internal_boxtype(Fl_Boxtype, Fl_Box_Draw_F*);
 
 
 Fl_Boxtype fl_define_FL_PLASTIC_UP_BOX() {
-  fl_internal_boxtype(_FL_PLASTIC_UP_BOX, up_box);
-  fl_internal_boxtype(_FL_PLASTIC_DOWN_BOX, down_box);
+  fl_internal_boxtype(_FL_PLASTIC_UP_BOX, cached_up_box);
+  fl_internal_boxtype(_FL_PLASTIC_DOWN_BOX, cached_down_box);
   fl_internal_boxtype(_FL_PLASTIC_UP_FRAME, up_frame);
   fl_internal_boxtype(_FL_PLASTIC_DOWN_FRAME, down_frame);
-  fl_internal_boxtype(_FL_PLASTIC_THIN_UP_BOX, thin_up_box);
-  fl_internal_boxtype(_FL_PLASTIC_THIN_DOWN_BOX, down_box);
+  fl_internal_boxtype(_FL_PLASTIC_THIN_UP_BOX, cached_thin_up_box);
+  fl_internal_boxtype(_FL_PLASTIC_THIN_DOWN_BOX, cached_down_box);
   fl_internal_boxtype(_FL_PLASTIC_ROUND_UP_BOX, up_round);
   fl_internal_boxtype(_FL_PLASTIC_ROUND_DOWN_BOX, down_round);
 
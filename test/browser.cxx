@@ -62,6 +62,7 @@ That was a blank line above this.
 #include <FL/Fl_Select_Browser.H>
 #include <FL/Fl_Double_Window.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Light_Button.H>
 #include <FL/Fl_Int_Input.H>
 #include <FL/Fl_Choice.H>
 #include <FL/Fl_Simple_Terminal.H>
@@ -78,6 +79,7 @@ Fl_Button       *top,
                 *visible,
                 *swap,
                 *sort;
+Fl_Light_Button *virt;
 Fl_Choice       *btype;
 Fl_Choice       *wtype;
 Fl_Int_Input    *field;
@@ -143,6 +145,30 @@ void sort_cb(Fl_Widget *, void *) {
   browser->sort(FL_SORT_ASCENDING);
 }
 
+// lines shown by the browser in virtual mode:
+char **vlines = 0;
+int nvlines = 0;
+
+const char *vline_cb(Fl_Browser *, int line, Fl_Image **, void *) {
+  return vlines[line-1];
+}
+
+void virtual_cb(Fl_Widget *, void *) {
+  if (virt->value()) {          // keep the loaded lines and show them virtually
+    nvlines = browser->size();
+    vlines = (char**)malloc(nvlines * sizeof(char*));
+    for (int t=1; t<=nvlines; t++) vlines[t-1] = strdup(browser->text(t));
+    browser->virtual_lines(nvlines, vline_cb);
+  } else {                      // leave virtual mode, sorting works again
+    browser->clear();
+    for (int t=0; t<nvlines; t++) { browser->add(vlines[t]); free(vlines[t]); }
+    free(vlines);
+    vlines = 0;
+    nvlines = 0;
+  }
+  browser->redraw();
+}
+
 void btype_cb(Fl_Widget *, void *) {
   for ( int t=1; t<=browser->size(); t++ ) browser->select(t,0);
   browser->select(1,0);         // leave focus box on first line
@@ -172,9 +198,13 @@ int main(int argc, char **argv) {
   }
   browser->position(0);
 
-  field = new Fl_Int_Input(55, 350, window.w()-55, 25, "Line #:");
+  field = new Fl_Int_Input(55, 350, window.w()-55-80, 25, "Line #:");
   field->callback(show_cb);
 
+  virt = new Fl_Light_Button(window.w()-80, 350, 80, 25, "Virtual");
+  virt->callback(virtual_cb);
+  virt->tooltip("Shows the lines with Fl_Browser::virtual_lines()\n(Sort does nothing in virtual mode)");
+
   top = new Fl_Button(0, 375, 80, 25, "Top");
   top->callback(show_cb);
 
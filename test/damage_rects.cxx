@@ -0,0 +1,120 @@
+//
+// Damage rectangle test program for the Fast Light Tool Kit (FLTK).
+//
+// This demo blinks 50 small "LEDs" spread over a double buffered
+// window and reports how many times per second the window is
+// flushed and how long a flush takes on average.
+//
+// Since FLTK 1.4.0 only the damaged rectangles of a double buffered
+// window are copied to the screen, not their bounding box. Choose
+// "two corners" to blink only two LEDs in opposite corners of the
+// window, the case that used to copy the whole window.
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Check_Button.H>
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h> // gettimeofday()
+#endif
+
+#define COLS    10
+#define ROWS    5
+#define LEDS    (COLS * ROWS)
+
+// Return the current time in seconds
+static double now() {
+#ifdef _WIN32
+  LARGE_INTEGER t, f;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&f);
+  return double(t.QuadPart) / double(f.QuadPart);
+#else
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + 0.000001 * t.tv_usec;
+#endif
+}
+
+// A double buffered window that measures its flush() calls
+class Bench_Window : public Fl_Double_Window {
+public:
+  int flushes;
+  double flush_time;
+  Bench_Window(int W, int H, const char *L = 0)
+    : Fl_Double_Window(W, H, L), flushes(0), flush_time(0.0) {}
+  void flush() {
+    double t = now();
+    Fl_Double_Window::flush();
+    flush_time += now() - t;
+    flushes++;
+  }
+};
+
+Bench_Window *window;
+Fl_Box *leds[LEDS];
+Fl_Box *status;
+Fl_Check_Button *corners;
+
+// Toggle an LED, which damages only its own rectangle
+void toggle(Fl_Box *led) {
+  led->color(led->color() == FL_RED ? FL_DARK_RED : FL_RED);
+  led->redraw();
+}
+
+void blink_cb(void *) {
+  if (corners->value()) {
+    toggle(leds[0]);
+    toggle(leds[LEDS - 1]);
+  } else {
+    for (int i = 0; i < LEDS; i++)
+      if (rand() % 4 == 0) toggle(leds[i]);
+  }
+  Fl::repeat_timeout(0.02, blink_cb);
+}
+
+void status_cb(void *) {
+  static char buf[80];
+  if (window->flushes)
+    snprintf(buf, sizeof(buf), "%d flushes/s, %.1f us per flush",
+             window->flushes, 1000000.0 * window->flush_time / window->flushes);
+  else
+    snprintf(buf, sizeof(buf), "no flushes");
+  status->label(buf);
+  window->flushes = 0;
+  window->flush_time = 0.0;
+  Fl::repeat_timeout(1.0, status_cb);
+}
+
+int main(int argc, char **argv) {
+  window = new Bench_Window(420, 300, "damage_rects");
+  for (int i = 0; i < LEDS; i++) {
+    leds[i] = new Fl_Box(FL_OVAL_BOX, 20 + (i % COLS) * 40, 20 + (i / COLS) * 40, 12, 12, 0);
+    leds[i]->color(FL_DARK_RED);
+  }
+  corners = new Fl_Check_Button(20, 230, 200, 25, "two corners");
+  status = new Fl_Box(20, 260, 380, 25, "measuring...");
+  status->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+  window->end();
+  window->show(argc, argv);
+  Fl::add_timeout(0.02, blink_cb);
+  Fl::add_timeout(1.0, status_cb);
+  return Fl::run();
+}
@@ -797,24 +797,27 @@ void replall_cb(Fl_Widget*, void* v) {
 
   e->replace_dlg->hide();
 
-  e->editor->insert_position(0);
   int times = 0;
+  int pos = 0;
 
-  // Loop through the whole string
+  // Replace all matches at once, the editor is updated only once at the end
+  textbuf->begin_transaction();
   for (int found = 1; found;) {
-    int pos = e->editor->insert_position();
     found = textbuf->search_forward(pos, find, &pos);
 
     if (found) {
-      // Found a match; update the position and replace text...
-      textbuf->select(pos, pos+strlen(find));
-      textbuf->remove_selection();
-      textbuf->insert(pos, replace);
-      e->editor->insert_position(pos+strlen(replace));
-      e->editor->show_insert_position();
+      // Found a match; replace the text and continue after it...
+      textbuf->replace(pos, pos+strlen(find), replace);
+      pos += strlen(replace);
       times++;
     }
   }
+  textbuf->end_transaction();
+
+  if (times) {
+    e->editor->insert_position(pos);
+    e->editor->show_insert_position();
+  }
 
   if (times) fl_message("Replaced %d occurrences.", times);
   else fl_alert("No occurrences of \'%s\' found!", find);